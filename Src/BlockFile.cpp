@@ -31,24 +31,95 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdint>
+#include <zlib.h>
 #include "Supermodel.h"
 
 
+/******************************************************************************
+ Low-Level I/O
+
+ All accesses go through these so that the rest of the implementation does not
+ need to care whether the block file lives on disk or in memory.
+******************************************************************************/
+
+bool CBlockFile::IsOpen(void) const
+{
+  return fp != NULL || memWrite != NULL || memRead != NULL;
+}
+
+size_t CBlockFile::RawRead(void *data, size_t numBytes)
+{
+  if (memRead != NULL)
+  {
+    if (memPos >= memSize)
+      return 0;
+    size_t avail = size_t(memSize - memPos);
+    if (numBytes > avail)
+      numBytes = avail;
+    memcpy(data, &memRead[memPos], numBytes);
+    memPos += long(numBytes);
+    return numBytes;
+  }
+  if (fp != NULL && !indexed)  // indexed files are only read a block at a time
+    return fread(data, sizeof(uint8_t), numBytes, fp);
+  return 0;
+}
+
+size_t CBlockFile::RawWrite(const void *data, size_t numBytes)
+{
+  if (memWrite != NULL)
+  {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    size_t size = memWrite->size();
+    if (size_t(memPos) == size)
+      memWrite->insert(memWrite->end(), bytes, bytes + numBytes);  // common case: append
+    else
+    {
+      if (size_t(memPos) + numBytes > size)
+        memWrite->resize(memPos + numBytes);
+      memcpy(&(*memWrite)[memPos], bytes, numBytes);
+    }
+    memPos += long(numBytes);
+    return numBytes;
+  }
+  if (fp != NULL)
+    return fwrite(data, sizeof(uint8_t), numBytes, fp);
+  return 0;
+}
+
+long int CBlockFile::RawTell(void) const
+{
+  if (memRead != NULL || memWrite != NULL)
+    return memPos;
+  if (fp != NULL)
+    return ftell(fp);
+  return 0;
+}
+
+void CBlockFile::RawSeek(long int pos)
+{
+  if (memRead != NULL || memWrite != NULL)
+    memPos = pos;
+  else if (fp != NULL)
+    fseek(fp, pos, SEEK_SET);
+}
+
+
 /******************************************************************************
  Output Functions
 ******************************************************************************/
 
 void CBlockFile::ReadString(std::string *str, uint32_t length)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return;
   str->clear();
   //TODO: use fstream to get rid of this ugly hack
   bool keep_loading = true;
   for (uint32_t i = 0; i < length; i++)
   {
-    char c;
-    fread(&c, sizeof(char), 1, fp);
+    char c = 0;
+    RawRead(&c, sizeof(char));
     if (keep_loading)
     {
       if (!c)
@@ -61,64 +132,79 @@ void CBlockFile::ReadString(std::string *str, uint32_t length)
 
 unsigned CBlockFile::ReadBytes(void *data, uint32_t numBytes)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return 0;
-  return fread(data, sizeof(uint8_t), numBytes, fp);
+  return unsigned(RawRead(data, numBytes));
 }
 
 unsigned CBlockFile::ReadDWord(uint32_t *data)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return 0;
-  fread(data, sizeof(uint32_t), 1, fp);
+  RawRead(data, sizeof(uint32_t));
   return 4;
 }
   
 void CBlockFile::UpdateBlockSize(void)
 {
   long int  curPos;
-  unsigned  newBlockSize;
+  uint32_t  newBlockSize;
   
-  if (NULL == fp)
+  if (!IsOpen() || indexed)  // indexed files record sizes in the index
     return;
-  curPos = ftell(fp);       // save current file position
-  fseek(fp, blockStartPos, SEEK_SET);
-  newBlockSize = curPos - blockStartPos;
-  fwrite(&newBlockSize, sizeof(uint32_t), 1, fp);
-  fseek(fp, curPos, SEEK_SET);  // go back
+  curPos = RawTell();       // save current file position
+  newBlockSize = uint32_t(curPos - blockStartPos);
+  if (memWrite != NULL)
+    memcpy(&(*memWrite)[blockStartPos], &newBlockSize, sizeof(uint32_t));  // patch in place, no need to seek
+  else
+  {
+    fseek(fp, blockStartPos, SEEK_SET);
+    fwrite(&newBlockSize, sizeof(uint32_t), 1, fp);
+    fseek(fp, curPos, SEEK_SET);  // go back
+  }
 }
 
 void CBlockFile::WriteByte(uint8_t data)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return;
-  fwrite(&data, sizeof(uint8_t), 1, fp);
+  RawWrite(&data, sizeof(uint8_t));
   UpdateBlockSize();
 }
 
 void CBlockFile::WriteDWord(uint32_t data)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return;
-  fwrite(&data, sizeof(uint32_t), 1, fp);
+  RawWrite(&data, sizeof(uint32_t));
   UpdateBlockSize();
 }
 
 void CBlockFile::WriteBytes(const void *data, uint32_t numBytes)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return;
-  fwrite(data, sizeof(uint8_t), numBytes, fp);
+  RawWrite(data, numBytes);
   UpdateBlockSize();
 }
 
 void CBlockFile::WriteBlockHeader(const std::string &name, const std::string &comment)
 {
-  if (NULL == fp)
+  if (!IsOpen())
     return;
+
+  // Indexed files: finish the previous block and start buffering a new one
+  if (indexed)
+  {
+    FlushIndexedBlock();
+    index.push_back(IndexEntry{ name, comment, 0, 0, 0, 0, CODEC_NONE });
+    blockData.clear();
+    memPos = 0;
+    return;
+  }
   
   // Record current block starting position
-  blockStartPos = ftell(fp);
+  blockStartPos = RawTell();
 
   // Write the total block length field
   WriteDWord(0);  // will be automatically updated as we write the file
@@ -130,14 +216,184 @@ void CBlockFile::WriteBlockHeader(const std::string &name, const std::string &co
   Write(comment);
   
   // Record the start of the current data section
-  dataStartPos = ftell(fp);
+  dataStartPos = RawTell();
 } 
 
 
+/******************************************************************************
+ Indexed Format (Version 2)
+
+ All multi-byte values are little endian.
+
+ File Header
+ -----------
+ magic        (uint32_t)  "SMBI"
+ version      (uint32_t)  2
+ indexOffset  (uint64_t)  File offset of the index.
+ indexCount   (uint32_t)  Number of index entries.
+ reserved     (uint32_t)  0.
+
+ The header is followed by the stored data of each block, back to back, and
+ then by the index. The index offset is patched into the header on Close().
+
+ Index Entry
+ -----------
+ nameLength     (uint32_t)  Length of name including terminating 0.
+ name           ...         Name string.
+ commentLength  (uint32_t)  Same as above, but for comment string.
+ comment        ...         Comment string.
+ offset         (uint64_t)  File offset of stored data.
+ storedSize     (uint64_t)  Size of stored data.
+ rawSize        (uint64_t)  Size of data after decompression.
+ checksum       (uint32_t)  CRC-32 of uncompressed data.
+ codec          (uint32_t)  0 = none, 1 = zlib.
+******************************************************************************/
+
+static const long int INDEXED_HEADER_SIZE = 24;
+
+Result CBlockFile::FlushIndexedBlock(void)
+{
+  // Nothing to do if no block is pending (stored blocks have a non-zero
+  // offset because they follow the file header)
+  if (index.empty() || index.back().offset != 0)
+    return Result::OKAY;
+
+  IndexEntry &entry = index.back();
+  entry.rawSize = blockData.size();
+  entry.checksum = uint32_t(crc32(0, blockData.data(), uInt(blockData.size())));
+  entry.codec = CODEC_NONE;
+  const uint8_t *stored = blockData.data();
+  size_t storedSize = blockData.size();
+  if (compress && !blockData.empty())
+  {
+    uLongf packedSize = compressBound(uLong(blockData.size()));
+    packedData.resize(packedSize);
+    if (Z_OK == compress2(packedData.data(), &packedSize, blockData.data(), uLong(blockData.size()), Z_BEST_SPEED) && packedSize < blockData.size())
+    {
+      entry.codec = CODEC_ZLIB;
+      stored = packedData.data();
+      storedSize = packedSize;
+    }
+  }
+
+  fseek(fp, 0, SEEK_END);
+  entry.offset = uint64_t(ftell(fp));
+  entry.storedSize = storedSize;
+  if (storedSize && fwrite(stored, sizeof(uint8_t), storedSize, fp) != storedSize)
+    return Result::FAIL;
+  return Result::OKAY;
+}
+
+Result CBlockFile::WriteIndex(void)
+{
+  fseek(fp, 0, SEEK_END);
+  uint64_t indexOffset = uint64_t(ftell(fp));
+  for (auto &entry: index)
+  {
+    uint32_t nameLength = uint32_t(entry.name.size() + 1);
+    uint32_t commentLength = uint32_t(entry.comment.size() + 1);
+    fwrite(&nameLength, sizeof(nameLength), 1, fp);
+    fwrite(entry.name.c_str(), sizeof(char), nameLength, fp);
+    fwrite(&commentLength, sizeof(commentLength), 1, fp);
+    fwrite(entry.comment.c_str(), sizeof(char), commentLength, fp);
+    fwrite(&entry.offset, sizeof(entry.offset), 1, fp);
+    fwrite(&entry.storedSize, sizeof(entry.storedSize), 1, fp);
+    fwrite(&entry.rawSize, sizeof(entry.rawSize), 1, fp);
+    fwrite(&entry.checksum, sizeof(entry.checksum), 1, fp);
+    fwrite(&entry.codec, sizeof(entry.codec), 1, fp);
+  }
+
+  // Patch the header now that the index location is known
+  uint32_t indexCount = uint32_t(index.size());
+  fseek(fp, 8, SEEK_SET);
+  fwrite(&indexOffset, sizeof(indexOffset), 1, fp);
+  if (fwrite(&indexCount, sizeof(indexCount), 1, fp) != 1)
+    return Result::FAIL;
+  return ferror(fp) ? Result::FAIL : Result::OKAY;
+}
+
+Result CBlockFile::LoadIndex(void)
+{
+  uint32_t header[6];
+  fseek(fp, 0, SEEK_SET);
+  if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != INDEXED_MAGIC || header[1] != INDEXED_VERSION)
+    return Result::FAIL;
+  uint64_t indexOffset;
+  memcpy(&indexOffset, &header[2], sizeof(indexOffset));
+  uint32_t indexCount = header[4];
+  if (indexOffset < uint64_t(INDEXED_HEADER_SIZE) || indexOffset > uint64_t(fileSize))
+    return Result::FAIL;
+
+  fseek(fp, long(indexOffset), SEEK_SET);
+  index.clear();
+  indexByName.clear();
+  for (uint32_t i = 0; i < indexCount; i++)
+  {
+    IndexEntry entry;
+    uint32_t length;
+    std::string *strings[] = { &entry.name, &entry.comment };
+    for (std::string *str: strings)
+    {
+      if (fread(&length, sizeof(length), 1, fp) != 1 || length == 0 || length > 1025)
+        return Result::FAIL;
+      std::vector<char> chars(length);
+      if (fread(chars.data(), sizeof(char), length, fp) != length)
+        return Result::FAIL;
+      str->assign(chars.data(), strnlen(chars.data(), length));
+    }
+    if (fread(&entry.offset, sizeof(entry.offset), 1, fp) != 1 ||
+        fread(&entry.storedSize, sizeof(entry.storedSize), 1, fp) != 1 ||
+        fread(&entry.rawSize, sizeof(entry.rawSize), 1, fp) != 1 ||
+        fread(&entry.checksum, sizeof(entry.checksum), 1, fp) != 1 ||
+        fread(&entry.codec, sizeof(entry.codec), 1, fp) != 1)
+      return Result::FAIL;
+    if (entry.offset + entry.storedSize > indexOffset)
+      return Result::FAIL;
+    indexByName.emplace(entry.name, index.size()); // first occurrence wins, as with a linear scan
+    index.emplace_back(std::move(entry));
+  }
+  return Result::OKAY;
+}
+
+Result CBlockFile::FindIndexedBlock(const std::string &name)
+{
+  auto it = indexByName.find(name);
+  if (it == indexByName.end())
+    return Result::FAIL;
+  const IndexEntry &entry = index[it->second];
+
+  // Read the whole block into memory so that the checksum can be verified
+  // and subsequent reads are served from the buffer
+  memRead = NULL;
+  std::vector<uint8_t> &stored = entry.codec == CODEC_NONE ? blockData : packedData;
+  stored.resize(size_t(entry.storedSize));
+  fseek(fp, long(entry.offset), SEEK_SET);
+  if (entry.storedSize && fread(stored.data(), sizeof(uint8_t), stored.size(), fp) != stored.size())
+    return Result::FAIL;
+  if (entry.codec == CODEC_ZLIB)
+  {
+    blockData.resize(size_t(entry.rawSize));
+    uLongf rawSize = uLongf(entry.rawSize);
+    if (Z_OK != uncompress(blockData.data(), &rawSize, packedData.data(), uLong(packedData.size())) || rawSize != entry.rawSize)
+      return Result::FAIL;
+  }
+  else if (entry.codec != CODEC_NONE)
+    return Result::FAIL;
+  if (uint32_t(crc32(0, blockData.data(), uInt(blockData.size()))) != entry.checksum)
+    return Result::FAIL;
+
+  memRead = blockData.data();
+  memSize = long(blockData.size());
+  memPos = 0;
+  return Result::OKAY;
+}
+
+
 /******************************************************************************
  Block Format Container File Implementation
  
- Files are just a consecutive array of blocks that must be searched.
+ Original (version 1) files are just a consecutive array of blocks that must
+ be searched.
  
  Block Format
  ------------
@@ -194,8 +450,10 @@ Result CBlockFile::FindBlock(const std::string &name)
 {
   if (mode != 'r')
     return Result::FAIL;
+  if (indexed)
+    return FindIndexedBlock(name);
     
-  fseek(fp, 0, SEEK_SET);
+  RawSeek(0);
   
   long int  curPos = 0;
   while (curPos < fileSize)
@@ -215,13 +473,13 @@ Result CBlockFile::FindBlock(const std::string &name)
     // Is this the block we want?
     if (block_name == name)
     {
-      fseek(fp, blockStartPos + 12 + name_length + comment_length, SEEK_SET); // move to beginning of data
-      dataStartPos = ftell(fp);
+      RawSeek(blockStartPos + 12 + name_length + comment_length); // move to beginning of data
+      dataStartPos = RawTell();
       return Result::OKAY;
     }
     
     // Move to next block
-    fseek(fp, blockStartPos + block_length, SEEK_SET);
+    RawSeek(blockStartPos + block_length);
     curPos = blockStartPos + block_length;
     if (block_length == 0)  // this would never advance
       break;
@@ -239,6 +497,26 @@ Result CBlockFile::Create(const std::string &file, const std::string &headerName
   WriteBlockHeader(headerName, comment);
   return Result::OKAY;
 }
+
+Result CBlockFile::CreateIndexed(const std::string &file, const std::string &headerName, const std::string &comment, bool compressBlocks)
+{
+  fp = fopen(file.c_str(), "wb");
+  if (NULL == fp)
+    return Result::FAIL;
+  mode = 'w';
+  indexed = true;
+  compress = compressBlocks;
+  index.clear();
+
+  // Header is completed by WriteIndex()
+  uint32_t header[6] = { INDEXED_MAGIC, INDEXED_VERSION, 0, 0, 0, 0 };
+  fwrite(header, sizeof(header), 1, fp);
+
+  // Block data is buffered in memory until complete
+  memWrite = &blockData;
+  WriteBlockHeader(headerName, comment);
+  return Result::OKAY;
+}
   
 Result CBlockFile::Load(const std::string &file)
 {
@@ -253,28 +531,87 @@ Result CBlockFile::Load(const std::string &file)
   fseek(fp, 0, SEEK_END);
   fileSize = ftell(fp);
   fseek(fp, 0, SEEK_SET);
+
+  // Indexed files are identified by their magic number. Original block files
+  // begin with the header block length, which is never this large.
+  uint32_t magic = 0;
+  if (fread(&magic, sizeof(magic), 1, fp) == 1 && magic == INDEXED_MAGIC)
+  {
+    indexed = true;
+    if (Result::OKAY != LoadIndex())
+    {
+      Close();
+      return Result::FAIL;
+    }
+  }
+  fseek(fp, 0, SEEK_SET);
   
   return Result::OKAY;
 }
+
+Result CBlockFile::Create(std::vector<uint8_t> *buffer, const std::string &headerName, const std::string &comment)
+{
+  if (NULL == buffer)
+    return Result::FAIL;
+  memWrite = buffer;
+  memWrite->clear();
+  memPos = 0;
+  mode = 'w';
+  WriteBlockHeader(headerName, comment);
+  return Result::OKAY;
+}
+
+Result CBlockFile::Load(const uint8_t *data, size_t size)
+{
+  if (NULL == data)
+    return Result::FAIL;
+  memRead = data;
+  memSize = long(size);
+  memPos = 0;
+  fileSize = long(size);
+  mode = 'r';
+  return Result::OKAY;
+}
   
-void CBlockFile::Close(void)
+Result CBlockFile::Close(void)
 {
+  Result result = Result::OKAY;
+  if (indexed && mode == 'w' && fp != NULL)
+  {
+    if (Result::OKAY != FlushIndexedBlock() || Result::OKAY != WriteIndex())
+      result = Result::FAIL;
+  }
   if (fp != NULL)
     fclose(fp);
   fp = NULL;
+  memWrite = NULL;
+  memRead = NULL;
+  memSize = 0;
+  memPos = 0;
   mode = 0;
+  indexed = false;
+  compress = false;
+  index.clear();
+  indexByName.clear();
+  blockData.clear();
+  packedData.clear();
+  return result;
 }
 
 CBlockFile::CBlockFile(void)
 {
   fp = NULL;
+  memWrite = NULL;
+  memRead = NULL;
+  memSize = 0;
+  memPos = 0;
+  fileSize = 0;
+  indexed = false;
+  compress = false;
   mode = 0;   // neither reading nor writing (do nothing)
 }
 
 CBlockFile::~CBlockFile(void)
 {
-  if (fp != NULL) // in case user forgot
-    fclose(fp);
-  fp = NULL;
-  mode = 0;
+  Close();  // in case user forgot
 }
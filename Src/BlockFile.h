@@ -29,7 +29,10 @@
 #define INCLUDED_BLOCKFILE_H
 
 #include <cstdint>
+#include <cstdio>
+#include <map>
 #include <string>
+#include <vector>
 #include "Types.h"
 
 /*
@@ -41,6 +44,16 @@
  * All strings (comments and names) will be truncated to 1024 bytes, not
  * including the null terminator.
  *
+ * Block files may be backed either by a file on disk or by a memory buffer.
+ * The latter is intended for frequent, short-lived snapshots (e.g., rewind)
+ * where going through the file system would be too slow.
+ *
+ * Files on disk may alternatively be written in an indexed format (version 2)
+ * that stores a table of block names, offsets, sizes, and checksums, and that
+ * optionally compresses each block. Blocks can then be located without
+ * scanning and unneeded ones are never read. Load() detects the format
+ * automatically, so both kinds can always be read.
+ *
  * Members do not generate any output messages.
  */
 class CBlockFile
@@ -152,6 +165,24 @@ public:
    */
   Result Create(const std::string &file, const std::string &headerName, const std::string &comment);
 
+  /*
+   * CreateIndexed(file, headerName, comment, compress):
+   *
+   * Same as Create() above but writes the indexed (version 2) format. Block
+   * data is buffered in memory until the next block is started and the index
+   * is written by Close(), which must be called for the file to be valid.
+   *
+   * Parameters:
+   *    file        File path.
+   *    headerName  Block name for header. Must be unique and not NULL.
+   *    comment     Comment string that will be embedded into file header.
+   *    compress    If true, block data is compressed with zlib.
+   *
+   * Returns:
+   *    OKAY if successfully opened, otherwise FAIL.
+   */
+  Result CreateIndexed(const std::string &file, const std::string &headerName, const std::string &comment, bool compress);
+
   /*
    * Load(file):
    *
@@ -168,12 +199,49 @@ public:
    */
   Result Load(const std::string &file);
 
+  /*
+   * Create(buffer, headerName, comment):
+   *
+   * Same as Create() above but writes to a memory buffer instead of a file.
+   * The buffer is cleared first (its capacity is retained, so re-using the
+   * same buffer avoids reallocation) and must remain valid until Close() is
+   * called.
+   *
+   * Parameters:
+   *    buffer      Buffer to write to.
+   *    headerName  Block name for header. Must be unique and not NULL.
+   *    comment     Comment string that will be embedded into file header.
+   *
+   * Returns:
+   *    OKAY if successfully opened, otherwise FAIL.
+   */
+  Result Create(std::vector<uint8_t> *buffer, const std::string &headerName, const std::string &comment);
+
+  /*
+   * Load(data, size):
+   *
+   * Opens a block file image held in memory for reading. The data is not
+   * copied and must remain valid until Close() is called.
+   *
+   * Parameters:
+   *    data  Pointer to block file image.
+   *    size  Size of image in bytes.
+   *
+   * Returns:
+   *    OKAY if successfully opened, otherwise FAIL.
+   */
+  Result Load(const uint8_t *data, size_t size);
+
   /*
    * Close(void):
    *
-   * Closes the file.
+   * Closes the file. For indexed files being written, flushes the last block
+   * and writes the index.
+   *
+   * Returns:
+   *    OKAY if successful, FAIL if an indexed file could not be completed.
    */
-  void Close(void);
+  Result Close(void);
 
   /*
    * CBlockFile(void):
@@ -185,6 +253,36 @@ public:
   ~CBlockFile(void);
 
 private:
+  // Index entry for indexed (version 2) files
+  struct IndexEntry
+  {
+    std::string name;
+    std::string comment;
+    uint64_t    offset;     // file offset of stored data
+    uint64_t    storedSize; // size of stored (possibly compressed) data
+    uint64_t    rawSize;    // size of data after decompression
+    uint32_t    checksum;   // CRC-32 of uncompressed data
+    uint32_t    codec;      // one of the CODEC_* values
+  };
+
+  static const uint32_t INDEXED_MAGIC = 0x49424D53;  // "SMBI" in little endian
+  static const uint32_t INDEXED_VERSION = 2;
+  static const uint32_t CODEC_NONE = 0;
+  static const uint32_t CODEC_ZLIB = 1;
+
+  // Indexed format helpers
+  Result  LoadIndex(void);
+  Result  FindIndexedBlock(const std::string &name);
+  Result  FlushIndexedBlock(void);
+  Result  WriteIndex(void);
+
+  // Low-level I/O (dispatches to file or memory buffer)
+  bool      IsOpen(void) const;
+  size_t    RawRead(void *data, size_t numBytes);
+  size_t    RawWrite(const void *data, size_t numBytes);
+  long int  RawTell(void) const;
+  void      RawSeek(long int pos);
+
   // Helper functions
   void      ReadString(std::string *str, uint32_t length);
   unsigned  ReadBytes(void *data, uint32_t numBytes);
@@ -201,6 +299,21 @@ private:
   long int  fileSize;       // size of file in bytes
   long int  blockStartPos;  // points to beginning of current block (or file) header
   long int  dataStartPos;   // points to beginning of current block's data section 
+
+  // Memory buffer state data (used when fp is NULL, or for the current block
+  // of an indexed file)
+  std::vector<uint8_t>  *memWrite;  // buffer being written to
+  const uint8_t         *memRead;   // image being read from
+  long int              memSize;    // size of image being read from
+  long int              memPos;     // current position within buffer
+
+  // Indexed file state data
+  bool                    indexed;
+  bool                    compress;     // compress blocks being written
+  std::vector<IndexEntry> index;        // in file order
+  std::map<std::string, size_t> indexByName;
+  std::vector<uint8_t>    blockData;    // current block (uncompressed)
+  std::vector<uint8_t>    packedData;   // compression buffer
 };
 
 
@@ -1,13 +1,22 @@
 #include "GameLoader.h"
 #include "OSD/Logger.h"
+#include "OSD/VirtualMemory.h"
 #include "Util/NewConfig.h"
 #include "Util/ConfigBuilders.h"
 #include "Util/ByteSwap.h"
 #include "Util/Format.h"
+#include "Version.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <numeric>
+#include <thread>
+#include <zlib.h>
 
 bool GameLoader::LoadZipArchive(ZipArchive *zip, const std::string &zipfilename) const
 {
@@ -29,7 +38,8 @@ bool GameLoader::LoadZipArchive(ZipArchive *zip, const std::string &zipfilename)
     if (UNZ_OK != unzGetCurrentFileInfo(zf, &file_info, filename_buffer, sizeof(filename_buffer), NULL, 0, NULL, 0))
       continue;
     zip->files_by_crc[file_info.crc].zf = zf;
-    zip->files_by_crc[file_info.crc].zipfilename = filename_buffer;
+    zip->files_by_crc[file_info.crc].archive = zip->zfs.size() - 1;
+    zip->files_by_crc[file_info.crc].zipfilename = zipfilename;
     zip->files_by_crc[file_info.crc].filename = filename_buffer;
     zip->files_by_crc[file_info.crc].uncompressed_size = file_info.uncompressed_size;
     zip->files_by_crc[file_info.crc].crc32 = file_info.crc;
@@ -90,37 +100,35 @@ const GameLoader::ZippedFile *GameLoader::LookupFile(const File::ptr_t &file, co
   return nullptr;
 }
 
-bool GameLoader::LoadZippedFile(std::shared_ptr<uint8_t> *buffer, size_t *file_size, const GameLoader::File::ptr_t &file, const ZipArchive &zip) const
+bool GameLoader::LoadZippedFile(std::vector<uint8_t> *buffer, const ZippedFile &zipped_file, unzFile zf)
 {
-  // Locate file
-  const ZippedFile *zipped_file = LookupFile(file, zip);
-  if (!zipped_file)
-    return true;
-  if (UNZ_OK != unzLocateFile(zipped_file->zf, zipped_file->filename.c_str(), 2))
+  // Locate file. The handle is passed in rather than taken from zipped_file
+  // because minizip handles must not be shared between threads.
+  if (UNZ_OK != unzLocateFile(zf, zipped_file.filename.c_str(), 2))
   {
-    ErrorLog("Unable to locate '%s' in '%s'. Is zip file corrupt?", zipped_file->filename.c_str(), zipped_file->zipfilename.c_str());
+    ErrorLog("Unable to locate '%s' in '%s'. Is zip file corrupt?", zipped_file.filename.c_str(), zipped_file.zipfilename.c_str());
     return true;
   }
 
   // Read it in
-  if (UNZ_OK != unzOpenCurrentFile(zipped_file->zf))
+  if (UNZ_OK != unzOpenCurrentFile(zf))
   {
-    ErrorLog("Unable to read '%s' from '%s'. Is zip file corrupt?", zipped_file->filename.c_str(), zipped_file->zipfilename.c_str());
+    ErrorLog("Unable to read '%s' from '%s'. Is zip file corrupt?", zipped_file.filename.c_str(), zipped_file.zipfilename.c_str());
     return true;
   }
-  *file_size = zipped_file->uncompressed_size;
-  buffer->reset(new uint8_t[*file_size], std::default_delete<uint8_t[]>());
-  size_t bytes_read = (size_t) unzReadCurrentFile(zipped_file->zf, buffer->get(), *file_size);
-  if (bytes_read != *file_size)
+  size_t file_size = zipped_file.uncompressed_size;
+  buffer->resize(file_size);
+  size_t bytes_read = (size_t) unzReadCurrentFile(zf, buffer->data(), unsigned(file_size));
+  if (bytes_read != file_size)
   {
-    ErrorLog("Unable to read '%s' from '%s'. Is zip file corrupt?", zipped_file->filename.c_str(), zipped_file->zipfilename.c_str());
-    unzCloseCurrentFile(zipped_file->zf);
+    ErrorLog("Unable to read '%s' from '%s'. Is zip file corrupt?", zipped_file.filename.c_str(), zipped_file.zipfilename.c_str());
+    unzCloseCurrentFile(zf);
     return true;
   }
 
   // And close it
-  if (UNZ_CRCERROR == unzCloseCurrentFile(zipped_file->zf))
-    ErrorLog("CRC error reading '%s' from '%s'. File may be corrupt.", zipped_file->filename.c_str(), zipped_file->zipfilename.c_str());
+  if (UNZ_CRCERROR == unzCloseCurrentFile(zf))
+    ErrorLog("CRC error reading '%s' from '%s'. File may be corrupt.", zipped_file.filename.c_str(), zipped_file.zipfilename.c_str());
   return false;
 }
 
@@ -539,16 +547,416 @@ bool GameLoader::ParseXML(const Util::Config::Node &xml)
   return error;
 }
 
+/*
+ * Game Definition Cache
+ *
+ * Parsing Games.xml and merging child sets with their parents takes a
+ * noticeable part of startup. The result is therefore cached next to the XML
+ * file (Games.xml.cache) and loaded with a single read on later runs. The
+ * cache is used only if the XML file's size, modification time, and CRC32
+ * match the ones recorded in it, and if it was written by the same version of
+ * Supermodel. Files and regions shared between games (merged child sets reuse
+ * their parents' files) are stored once in tables and referenced by index, so
+ * pointer sharing is the same as after a fresh parse.
+ *
+ * Layout (native byte order, strings are u32 length + bytes):
+ *
+ *  magic "SMGC", format version u32, Supermodel version string,
+ *  XML size u64, XML mtime i64, XML CRC32 u32, payload size u32,
+ *  payload CRC32 u32, payload:
+ *    files:    count, { offset u32, filename, crc32 u32, has_crc32 u8 }
+ *    regions:  count, { name, stride u64, chunk_size u64, byte_layout,
+ *                       required u8, file count, file indices u32 }
+ *    games:    count, { Game fields }
+ *    patches:  count, { game, count, { region, count, { offset u32,
+ *                       value u64, bits u32 } } }
+ *    regions by game, then by merged game:
+ *              count, { game, count, { region name, region index u32 } }
+ */
+
+static const uint32_t CACHE_FORMAT_VERSION = 1; // bump when Game, Region, or File change
+
+namespace
+{
+  struct CacheWriter
+  {
+    std::vector<uint8_t> buf;
+
+    template <typename T>
+    void Put(T value)
+    {
+      const uint8_t *p = reinterpret_cast<const uint8_t *>(&value);
+      buf.insert(buf.end(), p, p + sizeof(T));
+    }
+
+    void PutString(const std::string &str)
+    {
+      Put<uint32_t>(uint32_t(str.size()));
+      buf.insert(buf.end(), str.begin(), str.end());
+    }
+  };
+
+  struct CacheReader
+  {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool error = false;
+
+    template <typename T>
+    T Get()
+    {
+      T value = T();
+      if (size_t(end - p) < sizeof(T))
+      {
+        error = true;
+        p = end;
+        return value;
+      }
+      memcpy(&value, p, sizeof(T));
+      p += sizeof(T);
+      return value;
+    }
+
+    std::string GetString()
+    {
+      uint32_t len = Get<uint32_t>();
+      if (size_t(end - p) < len)
+      {
+        error = true;
+        p = end;
+        return std::string();
+      }
+      std::string str(reinterpret_cast<const char *>(p), len);
+      p += len;
+      return str;
+    }
+
+    // Reads a count, rejecting values that cannot possibly fit in the rest of
+    // the data (so a corrupt cache cannot trigger a huge allocation)
+    uint32_t GetCount()
+    {
+      uint32_t count = Get<uint32_t>();
+      if (count > size_t(end - p))
+      {
+        error = true;
+        p = end;
+        return 0;
+      }
+      return count;
+    }
+  };
+}
+
+bool GameLoader::GetXMLFileStamp(XMLFileStamp *stamp, const std::string &filename)
+{
+  std::error_code ec;
+  std::filesystem::path path(filename);
+  uint64_t size = std::filesystem::file_size(path, ec);
+  if (ec)
+    return true;
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec)
+    return true;
+
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp)
+    return true;
+  std::vector<uint8_t> contents(size);
+  bool error = size && fread(contents.data(), size, 1, fp) != 1;
+  fclose(fp);
+  if (error)
+    return true;
+
+  stamp->size = size;
+  stamp->mtime = int64_t(mtime.time_since_epoch().count());
+  stamp->crc32 = uint32_t(::crc32(0, contents.data(), uInt(contents.size())));
+  return false;
+}
+
+bool GameLoader::LoadCache(const std::string &cache_filename, const XMLFileStamp &stamp)
+{
+  FILE *fp = fopen(cache_filename.c_str(), "rb");
+  if (!fp)
+    return true;
+  std::vector<uint8_t> data;
+  if (fseek(fp, 0, SEEK_END) == 0)
+  {
+    long size = ftell(fp);
+    if (size > 0 && fseek(fp, 0, SEEK_SET) == 0)
+    {
+      data.resize(size_t(size));
+      if (fread(data.data(), data.size(), 1, fp) != 1)
+        data.clear();
+    }
+  }
+  fclose(fp);
+
+  CacheReader in{ data.data(), data.data() + data.size() };
+  if (in.Get<uint32_t>() != *reinterpret_cast<const uint32_t *>("SMGC") ||
+      in.Get<uint32_t>() != CACHE_FORMAT_VERSION ||
+      in.GetString() != SUPERMODEL_VERSION ||
+      in.Get<uint64_t>() != stamp.size ||
+      in.Get<int64_t>() != stamp.mtime ||
+      in.Get<uint32_t>() != stamp.crc32 ||
+      in.error)
+    return true;
+  uint32_t payload_size = in.Get<uint32_t>();
+  uint32_t payload_crc32 = in.Get<uint32_t>();
+  if (in.error || size_t(in.end - in.p) != payload_size || payload_crc32 != uint32_t(::crc32(0, in.p, payload_size)))
+  {
+    ErrorLog("%s is corrupt and will be rebuilt.", cache_filename.c_str());
+    return true;
+  }
+
+  std::vector<File::ptr_t> files(in.GetCount());
+  for (auto &file: files)
+  {
+    file = std::make_shared<File>();
+    file->offset = in.Get<uint32_t>();
+    file->filename = in.GetString();
+    file->crc32 = in.Get<uint32_t>();
+    file->has_crc32 = in.Get<uint8_t>() != 0;
+  }
+
+  std::vector<Region::ptr_t> regions(in.GetCount());
+  for (auto &region: regions)
+  {
+    region = std::make_shared<Region>();
+    region->region_name = in.GetString();
+    region->stride = size_t(in.Get<uint64_t>());
+    region->chunk_size = size_t(in.Get<uint64_t>());
+    region->byte_layout = in.GetString();
+    region->required = in.Get<uint8_t>() != 0;
+    region->files.resize(in.GetCount());
+    for (auto &file: region->files)
+    {
+      uint32_t idx = in.Get<uint32_t>();
+      if (idx >= files.size())
+        return true;
+      file = files[idx];
+    }
+  }
+
+  std::map<std::string, Game> games;
+  for (uint32_t n = in.GetCount(); n > 0 && !in.error; n--)
+  {
+    Game game;
+    game.name = in.GetString();
+    game.parent = in.GetString();
+    game.title = in.GetString();
+    game.version = in.GetString();
+    game.manufacturer = in.GetString();
+    game.year = in.Get<uint32_t>();
+    game.stepping = in.GetString();
+    game.mpeg_board = in.GetString();
+    game.audio = Game::AudioTypes(in.Get<uint32_t>());
+    game.pci_bridge = in.GetString();
+    game.real3d_pci_id = in.Get<uint32_t>();
+    game.encryption_key = in.Get<uint32_t>();
+    game.netboard_present = in.Get<uint8_t>() != 0;
+    game.inputs = in.Get<uint32_t>();
+    game.driveboard_type = Game::DriveBoardType(in.Get<uint32_t>());
+    games.emplace_hint(games.end(), game.name, std::move(game));
+  }
+
+  std::map<std::string, PatchesByRegion_t> patches_by_game;
+  for (uint32_t n = in.GetCount(); n > 0 && !in.error; n--)
+  {
+    PatchesByRegion_t &patches_by_region = patches_by_game[in.GetString()];
+    for (uint32_t m = in.GetCount(); m > 0 && !in.error; m--)
+    {
+      std::vector<ROM::BigEndianPatch> &patches = patches_by_region[in.GetString()];
+      for (uint32_t k = in.GetCount(); k > 0 && !in.error; k--)
+      {
+        uint32_t offset = in.Get<uint32_t>();
+        uint64_t value = in.Get<uint64_t>();
+        unsigned bits = in.Get<uint32_t>();
+        patches.emplace_back(offset, value, bits);
+      }
+    }
+  }
+
+  auto read_regions_by_game = [&](std::map<std::string, RegionsByName_t> *regions_by_game)
+  {
+    for (uint32_t n = in.GetCount(); n > 0 && !in.error; n--)
+    {
+      RegionsByName_t &regions_by_name = (*regions_by_game)[in.GetString()];
+      for (uint32_t m = in.GetCount(); m > 0 && !in.error; m--)
+      {
+        std::string name = in.GetString();
+        uint32_t idx = in.Get<uint32_t>();
+        if (idx >= regions.size())
+        {
+          in.error = true;
+          return;
+        }
+        regions_by_name[name] = regions[idx];
+      }
+    }
+  };
+  std::map<std::string, RegionsByName_t> regions_by_game, regions_by_merged_game;
+  read_regions_by_game(&regions_by_game);
+  read_regions_by_game(&regions_by_merged_game);
+
+  if (in.error || in.p != in.end)
+    return true;
+
+  m_game_info_by_game.swap(games);
+  m_patches_by_game.swap(patches_by_game);
+  m_regions_by_game.swap(regions_by_game);
+  m_regions_by_merged_game.swap(regions_by_merged_game);
+  return false;
+}
+
+void GameLoader::SaveCache(const std::string &cache_filename, const XMLFileStamp &stamp) const
+{
+  // Number the files and regions, which may be shared between games
+  std::map<const File *, uint32_t> file_index;
+  std::map<const Region *, uint32_t> region_index;
+  std::vector<const File *> files;
+  std::vector<const Region *> regions;
+  for (auto *regions_by_game: { &m_regions_by_game, &m_regions_by_merged_game })
+  {
+    for (auto &v1: *regions_by_game)
+    {
+      for (auto &v2: v1.second)
+      {
+        const Region *region = v2.second.get();
+        if (!region_index.emplace(region, uint32_t(regions.size())).second)
+          continue;
+        regions.push_back(region);
+        for (auto &file: region->files)
+        {
+          if (file_index.emplace(file.get(), uint32_t(files.size())).second)
+            files.push_back(file.get());
+        }
+      }
+    }
+  }
+
+  CacheWriter out;
+  out.Put<uint32_t>(uint32_t(files.size()));
+  for (const File *file: files)
+  {
+    out.Put<uint32_t>(file->offset);
+    out.PutString(file->filename);
+    out.Put<uint32_t>(file->crc32);
+    out.Put<uint8_t>(file->has_crc32);
+  }
+
+  out.Put<uint32_t>(uint32_t(regions.size()));
+  for (const Region *region: regions)
+  {
+    out.PutString(region->region_name);
+    out.Put<uint64_t>(region->stride);
+    out.Put<uint64_t>(region->chunk_size);
+    out.PutString(region->byte_layout);
+    out.Put<uint8_t>(region->required);
+    out.Put<uint32_t>(uint32_t(region->files.size()));
+    for (auto &file: region->files)
+      out.Put<uint32_t>(file_index[file.get()]);
+  }
+
+  out.Put<uint32_t>(uint32_t(m_game_info_by_game.size()));
+  for (auto &v: m_game_info_by_game)
+  {
+    const Game &game = v.second;
+    out.PutString(game.name);
+    out.PutString(game.parent);
+    out.PutString(game.title);
+    out.PutString(game.version);
+    out.PutString(game.manufacturer);
+    out.Put<uint32_t>(game.year);
+    out.PutString(game.stepping);
+    out.PutString(game.mpeg_board);
+    out.Put<uint32_t>(game.audio);
+    out.PutString(game.pci_bridge);
+    out.Put<uint32_t>(game.real3d_pci_id);
+    out.Put<uint32_t>(game.encryption_key);
+    out.Put<uint8_t>(game.netboard_present);
+    out.Put<uint32_t>(game.inputs);
+    out.Put<uint32_t>(game.driveboard_type);
+  }
+
+  out.Put<uint32_t>(uint32_t(m_patches_by_game.size()));
+  for (auto &v1: m_patches_by_game)
+  {
+    out.PutString(v1.first);
+    out.Put<uint32_t>(uint32_t(v1.second.size()));
+    for (auto &v2: v1.second)
+    {
+      out.PutString(v2.first);
+      out.Put<uint32_t>(uint32_t(v2.second.size()));
+      for (auto &patch: v2.second)
+      {
+        out.Put<uint32_t>(patch.offset);
+        out.Put<uint64_t>(patch.value);
+        out.Put<uint32_t>(patch.bits);
+      }
+    }
+  }
+
+  for (auto *regions_by_game: { &m_regions_by_game, &m_regions_by_merged_game })
+  {
+    out.Put<uint32_t>(uint32_t(regions_by_game->size()));
+    for (auto &v1: *regions_by_game)
+    {
+      out.PutString(v1.first);
+      out.Put<uint32_t>(uint32_t(v1.second.size()));
+      for (auto &v2: v1.second)
+      {
+        out.PutString(v2.first);
+        out.Put<uint32_t>(region_index[v2.second.get()]);
+      }
+    }
+  }
+
+  CacheWriter header;
+  header.buf.insert(header.buf.end(), { 'S', 'M', 'G', 'C' });
+  header.Put<uint32_t>(CACHE_FORMAT_VERSION);
+  header.PutString(SUPERMODEL_VERSION);
+  header.Put<uint64_t>(stamp.size);
+  header.Put<int64_t>(stamp.mtime);
+  header.Put<uint32_t>(stamp.crc32);
+  header.Put<uint32_t>(uint32_t(out.buf.size()));
+  header.Put<uint32_t>(uint32_t(::crc32(0, out.buf.data(), uInt(out.buf.size()))));
+
+  // Not being able to write the cache (e.g., read-only directory) only costs
+  // startup time
+  FILE *fp = fopen(cache_filename.c_str(), "wb");
+  if (!fp)
+  {
+    DebugLog("Unable to write game definition cache: %s", cache_filename.c_str());
+    return;
+  }
+  bool error = fwrite(header.buf.data(), header.buf.size(), 1, fp) != 1 || fwrite(out.buf.data(), out.buf.size(), 1, fp) != 1;
+  fclose(fp);
+  if (error)
+    std::remove(cache_filename.c_str());
+}
+
 bool GameLoader::LoadDefinitionXML(const std::string &filename)
 {
   m_xml_filename = filename;
+  std::string cache_filename = filename + ".cache";
+  XMLFileStamp stamp;
+  bool no_stamp = GetXMLFileStamp(&stamp, filename);
+  if (!no_stamp && !LoadCache(cache_filename, stamp))
+  {
+    DebugLog("Loaded game definitions from %s.", cache_filename.c_str());
+    return false;
+  }
+
   Util::Config::Node xml("xml");
   if (Util::Config::FromXMLFile(&xml, filename))
   {
     ErrorLog("Game and ROM set definitions could not be loaded! ROMs will not be detected.");
     return true;
   }
-  return ParseXML(xml);
+  bool error = ParseXML(xml);
+  if (!error && !no_stamp)
+    SaveCache(cache_filename, stamp);
+  return error;
 }
 
 void GameLoader::FindEquivalentFiles(std::set<File::ptr_t> *equivalent_files, const std::set<File::ptr_t> &a, const std::set<File::ptr_t> &b)
@@ -777,11 +1185,16 @@ bool GameLoader::ComputeRegionSize(uint32_t *region_size, const GameLoader::Regi
   return error;
 }
 
-static bool ApplyLayout(ROM *rom, const std::string &byte_layout, size_t stride, const std::string &region_name)
+static bool ApplyLayout(ROM *rom, const std::string &byte_layout, size_t stride, const std::string &region_name, unsigned word_size)
 {
-  // Empty layout means do nothing
+  // Empty layout means do nothing, unless the ROM is to be word swapped for
+  // the emulator
   if (byte_layout.empty())
-    return false;
+  {
+    if (word_size <= 1)
+      return false;
+    return ApplyLayout(rom, "0", 1, region_name, word_size);
+  }
 
   // Validate that the layout string includes the same number of bytes as the region stride. The
   // stride is block size that the ROM files all contribute to. We also verify that each byte is
@@ -827,67 +1240,271 @@ static bool ApplyLayout(ROM *rom, const std::string &byte_layout, size_t stride,
   }
 
   // Okay, all good. Now we can reshuffle the region memory according to layout.
-  uint8_t *buffer = new uint8_t[stride];
+  // Conversion to little endian words is folded into the same pass by
+  // permuting blocks that span both a whole stride and a whole word.
+  size_t block_size = std::lcm(stride, size_t(word_size));
+  std::vector<size_t> block_offsets(block_size);
+  for (size_t i = 0; i < block_size; i++)
+  {
+    size_t j = (i / word_size) * word_size + (word_size - 1 - i % word_size); // byte i of the word swapped block comes from byte j of the laid out one
+    block_offsets[i] = (j / stride) * stride + byte_offsets[j % stride];
+  }
+  uint8_t buffer[8 * 4];
   uint8_t *dest = rom->data.get();
-  for (size_t dest_offset = 0; (dest_offset + stride) <= rom->size; dest_offset += stride)
+  for (size_t dest_offset = 0; (dest_offset + block_size) <= rom->size; dest_offset += block_size)
   {
     // Copy current region bytes to temporary buffer. The layout offsets refer to this original layout.
-    memcpy(buffer, dest + dest_offset, stride);
+    memcpy(buffer, dest + dest_offset, block_size);
 
     // Place the bytes back into the ROM region in the layout order specified.
-    for (size_t i = 0; i < stride; i++)
+    for (size_t i = 0; i < block_size; i++)
     {
-      dest[dest_offset + i] = buffer[byte_offsets[i]];
+      dest[dest_offset + i] = buffer[block_offsets[i]];
     }
   }
-  delete [] buffer;
 
   return false; // no error
 }
 
-bool GameLoader::LoadRegion(ROM *rom, const GameLoader::Region::ptr_t &region, const ZipArchive &zip) const
+static void CopyFileToRegion(ROM *rom, size_t region_chunk_size, size_t region_stride, uint32_t offset, const uint8_t *src, size_t file_size)
 {
-  bool error = false;
+  uint8_t *dest = rom->data.get();
+  if (region_chunk_size == region_stride)
+  {
+    memcpy(dest + offset, src, file_size);
+  }
+  else
+  {
+    uint32_t num_chunks = (uint32_t)(file_size / region_chunk_size);
+    uint32_t dest_offset = offset;
+    uint32_t src_offset = 0;
+    uint32_t chunk_size = (uint32_t)region_chunk_size;
+    uint32_t stride = (uint32_t)region_stride;
+    for (uint32_t i = 0; i < num_chunks; i++)
+    {
+      memcpy(dest + dest_offset, src + src_offset, chunk_size);
+      dest_offset += stride;
+      src_offset += chunk_size;
+    }
+  }
+}
 
-  for (auto &file: region->files)
+void GameLoader::LoadFiles(std::vector<LoadJob> *jobs, const ZipArchive &zip, unsigned num_threads)
+{
+  // Workers take the next job until none are left. Files of a region are
+  // copied to disjoint bytes of it, so no locking is needed. Each worker needs
+  // its own handles: the calling thread uses the archive's, the others open
+  // the zip files again.
+  std::atomic<size_t> next_job(0);
+  auto worker = [&](bool own_handles)
   {
-    std::shared_ptr<uint8_t> tmp;
-    size_t file_size;
-    error |= LoadZippedFile(&tmp, &file_size, file, zip);
-    if (!error)
+    std::vector<unzFile> zfs(zip.zfs.size(), nullptr);
+    std::vector<uint8_t> buffer;
+    for (size_t i = next_job++; i < jobs->size(); i = next_job++)
     {
-      uint8_t *dest = rom->data.get();
-      uint8_t *src = tmp.get();
-      if (region->chunk_size == region->stride)
+      LoadJob &job = (*jobs)[i];
+      size_t archive = job.zipped_file->archive;
+      if (!own_handles)
+        zfs[archive] = zip.zfs[archive];
+      else if (!zfs[archive] && !(zfs[archive] = unzOpen(zip.zipfilenames[archive].c_str())))
       {
-        memcpy(dest + file->offset, src, file_size);
+        ErrorLog("Could not open '%s'.", zip.zipfilenames[archive].c_str());
+        job.error = true;
+        continue;
       }
-      else
+      job.error = LoadZippedFile(&buffer, *job.zipped_file, zfs[archive]);
+      if (!job.error)
+        CopyFileToRegion(job.rom, job.region->chunk_size, job.region->stride, job.file->offset, buffer.data(), buffer.size());
+    }
+    if (own_handles)
+    {
+      for (auto &zf: zfs)
       {
-        uint32_t num_chunks = (uint32_t)(file_size / region->chunk_size);
-        uint32_t dest_offset = file->offset;
-        uint32_t src_offset = 0;
-        uint32_t chunk_size = (uint32_t)region->chunk_size;		// cache these as pointer dereferencing cripples performance in a tight loop
-        uint32_t stride = (uint32_t)region->stride;
-        for (uint32_t i = 0; i < num_chunks; i++)
-        {
-          memcpy(dest + dest_offset, src + src_offset, chunk_size);
-          dest_offset += stride;
-          src_offset += chunk_size;
-        }
+        if (zf)
+          unzClose(zf);
       }
     }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < num_threads; i++)
+    threads.emplace_back(worker, true);
+  worker(false);
+  for (auto &thread: threads)
+    thread.join();
+}
+
+/*
+ * ROM Image Cache
+ *
+ * Regions loaded into emulator memory are in their final form (laid out, word
+ * swapped, and patched), which is worth saving when a cache directory is
+ * configured. On later runs the cached images are memory mapped (or, where
+ * that is not possible, read) straight into the emulator's memory, skipping
+ * decompression, and pages the game never touches are never read from disk.
+ *
+ * The cache is valid if its manifest matches exactly. The manifest lists the
+ * Supermodel version and, for each region, its attributes, destination word
+ * size, files (by the CRC32 and size stored in the zip archive), and patches.
+ *
+ * Layout (native byte order):
+ *
+ *  magic "SMRC", format version u32, manifest size u32, region count u32,
+ *  manifest, regions: { name size u32, name, size u64, file offset u64 },
+ *  region data, each aligned to ROM_CACHE_ALIGNMENT
+ */
+
+static const uint32_t ROM_CACHE_FORMAT_VERSION = 1;
+static const uint64_t ROM_CACHE_ALIGNMENT = 0x10000;  // covers the page sizes MapFile() may need
+
+std::string GameLoader::GetROMCacheManifest(const std::string &game_name, const RegionsByName_t &regions_by_name, const ROMSet &rom_set, const std::map<std::string, unsigned> &word_size_by_region, const std::vector<LoadJob> &jobs) const
+{
+  Util::Format manifest;
+  manifest << SUPERMODEL_VERSION << '\n' << game_name << '\n';
+  auto &patches_by_region = m_patches_by_game.find(game_name)->second;
+  for (auto &v: word_size_by_region)
+  {
+    const Region &region = *regions_by_name.find(v.first)->second;
+    manifest << "region " << region.region_name << ' ' << rom_set.rom_by_region.find(v.first)->second.size << ' ' << v.second << ' ' << region.stride << ' ' << region.chunk_size << ' ' << region.byte_layout << '\n';
+    for (auto &job: jobs)
+    {
+      if (job.region->region_name == v.first)
+        manifest << "file " << job.file->offset << ' ' << job.zipped_file->crc32 << ' ' << job.zipped_file->uncompressed_size << '\n';
+    }
+    auto it = patches_by_region.find(v.first);
+    if (it != patches_by_region.end())
+    {
+      for (auto &patch: it->second)
+        manifest << "patch " << patch.offset << ' ' << patch.value << ' ' << patch.bits << '\n';
+    }
   }
+  return manifest.str();
+}
 
-  if (!error)
+void GameLoader::LoadROMCache(std::set<std::string> *cached_regions, ROMSet *rom_set, const std::string &cache_filename, const std::string &manifest)
+{
+  FILE *fp = fopen(cache_filename.c_str(), "rb");
+  if (!fp)
+    return;
+
+  // Validate header, manifest, and region table before touching any memory
+  struct CachedRegion
   {
-    error = ApplyLayout(rom, region->byte_layout, region->stride, region->region_name);
+    ROM *rom;
+    uint64_t offset;
+  };
+  std::map<std::string, CachedRegion> regions;
+  uint32_t header[4];
+  bool valid = fread(header, sizeof(header), 1, fp) == 1 &&
+               header[0] == *reinterpret_cast<const uint32_t *>("SMRC") &&
+               header[1] == ROM_CACHE_FORMAT_VERSION &&
+               header[2] == manifest.size();
+  if (valid)
+  {
+    std::string cached_manifest(manifest.size(), '\0');
+    valid = (manifest.empty() || fread(&cached_manifest[0], manifest.size(), 1, fp) == 1) && cached_manifest == manifest;
+  }
+  for (uint32_t i = 0; valid && i < header[3]; i++)
+  {
+    uint32_t name_size = 0;
+    uint64_t size_and_offset[2];
+    std::string name;
+    valid = fread(&name_size, sizeof(name_size), 1, fp) == 1 && name_size < 256;
+    if (valid)
+    {
+      name.resize(name_size);
+      valid = (!name_size || fread(&name[0], name_size, 1, fp) == 1) && fread(size_and_offset, sizeof(size_and_offset), 1, fp) == 1;
+    }
+    auto it = rom_set->rom_by_region.find(name);
+    valid = valid && it != rom_set->rom_by_region.end() && it->second.in_place && it->second.size == size_and_offset[0];
+    if (valid)
+      regions[name] = { &it->second, size_and_offset[1] };
+  }
+  if (!valid)
+  {
+    fclose(fp);
+    return;
   }
 
-  return error;
+  size_t num_mapped = 0;
+  for (auto &v: regions)
+  {
+    ROM &rom = *v.second.rom;
+    if (VirtualMemory::MapFile(rom.data.get(), rom.size, cache_filename, v.second.offset))
+    {
+      rom.mapped_file = cache_filename;
+      rom.mapped_offset = v.second.offset;
+      num_mapped++;
+    }
+    else if (fseek(fp, long(v.second.offset), SEEK_SET) != 0 || fread(rom.data.get(), rom.size, 1, fp) != 1)
+    {
+      ErrorLog("Unable to read '%s' from ROM cache '%s'.", v.first.c_str(), cache_filename.c_str());
+      continue;
+    }
+    cached_regions->insert(v.first);
+  }
+  fclose(fp);
+  InfoLog("Loaded %zu ROM regions from '%s' (%zu memory mapped).", cached_regions->size(), cache_filename.c_str(), num_mapped);
+}
+
+void GameLoader::SaveROMCache(const ROMSet &rom_set, const std::map<std::string, unsigned> &word_size_by_region, const std::string &cache_filename, const std::string &manifest)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(cache_filename).parent_path(), ec);
+  std::string tmp_filename = cache_filename + ".tmp";
+  FILE *fp = fopen(tmp_filename.c_str(), "wb");
+  if (!fp)
+  {
+    ErrorLog("Unable to write ROM cache '%s'.", cache_filename.c_str());
+    return;
+  }
+
+  // Region table, with data following it at aligned offsets
+  uint64_t offset = 4 * sizeof(uint32_t) + manifest.size();
+  for (auto &v: word_size_by_region)
+    offset += sizeof(uint32_t) + v.first.size() + 2 * sizeof(uint64_t);
+  std::vector<uint8_t> table;
+  std::vector<uint64_t> data_offsets;
+  for (auto &v: word_size_by_region)
+  {
+    const ROM &rom = rom_set.rom_by_region.find(v.first)->second;
+    offset = (offset + ROM_CACHE_ALIGNMENT - 1) & ~(ROM_CACHE_ALIGNMENT - 1);
+    uint32_t name_size = uint32_t(v.first.size());
+    uint64_t size_and_offset[2] = { rom.size, offset };
+    table.insert(table.end(), reinterpret_cast<const uint8_t *>(&name_size), reinterpret_cast<const uint8_t *>(&name_size + 1));
+    table.insert(table.end(), v.first.begin(), v.first.end());
+    table.insert(table.end(), reinterpret_cast<const uint8_t *>(size_and_offset), reinterpret_cast<const uint8_t *>(size_and_offset + 2));
+    data_offsets.push_back(offset);
+    offset += rom.size;
+  }
+
+  uint32_t header[4] = { *reinterpret_cast<const uint32_t *>("SMRC"), ROM_CACHE_FORMAT_VERSION, uint32_t(manifest.size()), uint32_t(word_size_by_region.size()) };
+  bool error = fwrite(header, sizeof(header), 1, fp) != 1 ||
+               fwrite(manifest.data(), manifest.size(), 1, fp) != 1 ||
+               fwrite(table.data(), table.size(), 1, fp) != 1;
+  size_t i = 0;
+  for (auto &v: word_size_by_region)
+  {
+    const ROM &rom = rom_set.rom_by_region.find(v.first)->second;
+    error = error || fseek(fp, long(data_offsets[i++]), SEEK_SET) != 0 || fwrite(rom.data.get(), rom.size, 1, fp) != 1;
+  }
+  error |= fclose(fp) != 0;
+
+  if (!error)
+  {
+    std::filesystem::rename(tmp_filename, cache_filename, ec);
+    error = bool(ec);
+  }
+  if (error)
+  {
+    std::remove(tmp_filename.c_str());
+    ErrorLog("Unable to write ROM cache '%s'.", cache_filename.c_str());
+  }
+  else
+    InfoLog("Saved ROM cache '%s'.", cache_filename.c_str());
 }
 
-bool GameLoader::LoadROMs(ROMSet *rom_set, const std::string &game_name, const ZipArchive &zip) const
+bool GameLoader::LoadROMs(ROMSet *rom_set, const std::string &game_name, const ZipArchive &zip, const ROMDestinationFn &destination, const std::string &cache_dir) const
 {
   auto it = m_game_info_by_game.find(game_name);
   if (it == m_game_info_by_game.end())
@@ -896,32 +1513,102 @@ bool GameLoader::LoadROMs(ROMSet *rom_set, const std::string &game_name, const Z
     return true;
   }
 
-  // Load up the ROMs
   auto &regions_by_name = IsChildSet(it->second) ? m_regions_by_merged_game.find(game_name)->second : m_regions_by_game.find(game_name)->second;
   LogROMDefinition(game_name, regions_by_name);
-  bool error = false;
+  auto t0 = std::chrono::steady_clock::now();
+
+  // Size and allocate the regions, gathering the files to load into them.
+  // Regions the emulator has room for are loaded directly into its memory.
+  std::map<std::string, bool> error_by_region;
+  std::map<std::string, unsigned> word_size_by_region;
+  std::vector<LoadJob> jobs;
   for (auto &v: regions_by_name)
   {
     auto &region = v.second;
     uint32_t region_size = 0;
-    bool error_loading_region = false;
-
-    // Attempt to load the region
     if (ComputeRegionSize(&region_size, region, zip))
-      error_loading_region = true;
-    else
     {
-      // Load up the ROM region
-      auto &rom = rom_set->rom_by_region[region->region_name];
+      error_by_region[region->region_name] = true;
+      continue;
+    }
+    auto &rom = rom_set->rom_by_region[region->region_name];
+    ROMDestination dest = destination ? destination(region->region_name, region_size) : ROMDestination();
+    if (dest.ptr && region_size <= dest.capacity)
+    {
+      rom.data.reset(dest.ptr, [](uint8_t *) {});
+      rom.in_place = true;
+      word_size_by_region[region->region_name] = dest.word_size;
+    }
+    else
       rom.data.reset(new uint8_t[region_size], std::default_delete<uint8_t[]>());
-      rom.size = region_size;
-      error_loading_region = LoadRegion(&rom, region, zip);
+    rom.size = region_size;
+    error_by_region[region->region_name] = false;
+    for (auto &file: region->files)
+    {
+      LoadJob job;
+      job.rom = &rom;
+      job.region = region;
+      job.file = file;
+      job.zipped_file = LookupFile(file, zip);
+      jobs.push_back(job);
     }
+  }
 
+  // Take whatever the ROM cache has instead of decompressing it
+  std::string cache_filename;
+  std::string manifest;
+  std::set<std::string> cached_regions;
+  if (!cache_dir.empty() && !word_size_by_region.empty())
+  {
+    cache_filename = (std::filesystem::path(cache_dir) / (game_name + ".romcache")).string();
+    manifest = GetROMCacheManifest(game_name, regions_by_name, *rom_set, word_size_by_region, jobs);
+    LoadROMCache(&cached_regions, rom_set, cache_filename, manifest);
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const LoadJob &job) { return cached_regions.count(job.region->region_name) != 0; }), jobs.end());
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  // Decompress all files in parallel, largest first so that the threads
+  // finish at about the same time
+  std::stable_sort(jobs.begin(), jobs.end(), [](const LoadJob &a, const LoadJob &b) { return a.zipped_file->uncompressed_size > b.zipped_file->uncompressed_size; });
+  unsigned num_threads = std::max(1u, std::min(std::thread::hardware_concurrency(), unsigned(jobs.size())));
+  LoadFiles(&jobs, zip, num_threads);
+  size_t total_size = 0;
+  for (auto &job: jobs)
+  {
+    error_by_region[job.region->region_name] |= job.error;
+    total_size += job.zipped_file->uncompressed_size;
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  // Interleave bytes of regions that were loaded successfully
+  for (auto &v: regions_by_name)
+  {
+    auto &region = v.second;
+    bool &error_loading_region = error_by_region[region->region_name];
+    auto it = word_size_by_region.find(region->region_name);
+    unsigned word_size = it == word_size_by_region.end() ? 1 : it->second;
+    if (!error_loading_region && !cached_regions.count(region->region_name))
+      error_loading_region = ApplyLayout(&rom_set->rom_by_region[region->region_name], region->byte_layout, region->stride, region->region_name, word_size);
+  }
+  auto t3 = std::chrono::steady_clock::now();
+
+  auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+  if (!jobs.empty())
+    InfoLog("Loaded %zu files (%.1f MB) in %.1f ms: allocation %.1f ms, decompression %.1f ms (%u threads), byte layout %.1f ms.",
+      jobs.size(), total_size / (1024.0 * 1024.0), ms(t3 - t0), ms(t1 - t0), ms(t2 - t1), num_threads, ms(t3 - t2));
+
+  bool error = false;
+  for (auto &v: regions_by_name)
+  {
+    auto &region = v.second;
+    bool error_loading_region = error_by_region[region->region_name];
     if (error_loading_region && !region->required)
     {
       // Failed to load the region but it wasn't required anyway, so remove it
       // and proceed
+      auto it = rom_set->rom_by_region.find(region->region_name);
+      if (it != rom_set->rom_by_region.end() && it->second.in_place)
+        memset(it->second.data.get(), 0, it->second.size);
       rom_set->rom_by_region.erase(region->region_name);
       ErrorLog("Optional ROM region '%s' in '%s' could not be loaded.", region->region_name.c_str(), game_name.c_str());
     }
@@ -943,6 +1630,21 @@ bool GameLoader::LoadROMs(ROMSet *rom_set, const std::string &game_name, const Z
     else if (rom_set->rom_by_region.find(region_name) != rom_set->rom_by_region.end())
       rom_set->rom_by_region[region_name].patches = patches;
   }
+
+  // Regions in emulator memory are final and must be patched here (cached
+  // ones already are)
+  for (auto &v: word_size_by_region)
+  {
+    auto it = rom_set->rom_by_region.find(v.first);
+    if (it != rom_set->rom_by_region.end() && !cached_regions.count(v.first))
+      it->second.ApplyPatches(it->second.data.get(), it->second.size, v.second);
+  }
+
+  // Refresh the cache if anything had to be decompressed, provided all of it
+  // loaded correctly
+  bool all_loaded = std::none_of(error_by_region.begin(), error_by_region.end(), [](const std::pair<const std::string, bool> &v) { return v.second; });
+  if (!cache_filename.empty() && all_loaded && cached_regions.size() != word_size_by_region.size())
+    SaveROMCache(*rom_set, word_size_by_region, cache_filename, manifest);
   return error;
 }
 
@@ -967,19 +1669,16 @@ std::string StripFilename(const std::string &filepath)
   return std::string(filepath, 0, last_slash + 1);
 }
 
-bool GameLoader::Load(Game *game, ROMSet *rom_set, const std::string &zipfilename) const
+bool GameLoader::OpenGame(Game *game, ZipArchive *zip, const std::string &zipfilename) const
 {
-  *game = Game();
-
   // Read the zip contents
-  ZipArchive zip;
-  if (LoadZipArchive(&zip, zipfilename))
+  if (LoadZipArchive(zip, zipfilename))
     return true;
 
   // Pick the game to load (there could be multiple ROM sets in a zip file)
   std::string chosen_game;
   bool missing_parent_roms = false;
-  ChooseGameInZipArchive(&chosen_game, &missing_parent_roms, zip, zipfilename);
+  ChooseGameInZipArchive(&chosen_game, &missing_parent_roms, *zip, zipfilename);
   if (chosen_game.empty())
     return true;
 
@@ -990,15 +1689,31 @@ bool GameLoader::Load(Game *game, ROMSet *rom_set, const std::string &zipfilenam
   if (missing_parent_roms)
   {
     std::string parent_zipfilename = StripFilename(zipfilename) + game->parent + ".zip";
-    if (LoadZipArchive(&zip, parent_zipfilename))
+    if (LoadZipArchive(zip, parent_zipfilename))
     {
       ErrorLog("Expected to find parent ROM set of '%s' at '%s'.", game->name.c_str(), parent_zipfilename.c_str());
       return true;
     }
   }
+  return false;
+}
+
+bool GameLoader::Identify(Game *game, const std::string &zipfilename) const
+{
+  *game = Game();
+  ZipArchive zip;
+  return OpenGame(game, &zip, zipfilename);
+}
+
+bool GameLoader::Load(Game *game, ROMSet *rom_set, const std::string &zipfilename, const ROMDestinationFn &destination, const std::string &cache_dir) const
+{
+  *game = Game();
+  ZipArchive zip;
+  if (OpenGame(game, &zip, zipfilename))
+    return true;
 
   // Load
-  bool error = LoadROMs(rom_set, game->name, zip);
+  bool error = LoadROMs(rom_set, game->name, zip, destination, cache_dir);
   if (error)
     *game = Game();
   return error;
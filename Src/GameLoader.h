@@ -57,6 +57,7 @@ private:
   struct ZippedFile
   {
     unzFile zf = nullptr;
+    size_t archive = 0;       // index of zip archive in ZipArchive
     std::string zipfilename;  // zip archive
     std::string filename;     // file inside the zip archive
     size_t uncompressed_size = 0;
@@ -82,12 +83,24 @@ private:
   bool LoadZipArchive(ZipArchive *zip, const std::string &zipfilename) const;
   const ZippedFile *LookupFile(const File::ptr_t &file, const ZipArchive &zip) const;
   bool FileExistsInZipArchive(const File::ptr_t &file, const ZipArchive &zip) const;
-  bool LoadZippedFile(std::shared_ptr<uint8_t> *buffer, size_t *file_size, const GameLoader::File::ptr_t &file, const ZipArchive &zip) const;
+  static bool LoadZippedFile(std::vector<uint8_t> *buffer, const ZippedFile &zipped_file, unzFile zf);
   static bool MissingAttrib(const GameLoader &loader, const Util::Config::Node &node, const std::string &attribute);
   bool LoadGamesFromXML(const Util::Config::Node &xml);
   bool MergeChildrenWithParents();
   void LogROMDefinition(const std::string &game_name, const RegionsByName_t &regions_by_name) const;
   bool ParseXML(const Util::Config::Node &xml);
+
+  // Binary cache of the parsed XML, valid only for an identical XML file
+  struct XMLFileStamp
+  {
+    uint64_t size;
+    int64_t mtime;
+    uint32_t crc32;
+  };
+  static bool GetXMLFileStamp(XMLFileStamp *stamp, const std::string &filename);
+  bool LoadCache(const std::string &cache_filename, const XMLFileStamp &stamp);
+  void SaveCache(const std::string &cache_filename, const XMLFileStamp &stamp) const;
+
   bool LoadDefinitionXML(const std::string &filename);
   static void FindEquivalentFiles(std::set<File::ptr_t> *equivalent_files, const std::set<File::ptr_t> &a, const std::set<File::ptr_t> &b);
   void IdentifyGamesInZipArchive(
@@ -97,12 +110,33 @@ private:
     const std::map<std::string, RegionsByName_t> &regions_by_game) const;
   bool ComputeRegionSize(uint32_t *region_size, const Region::ptr_t &region, const ZipArchive &zip) const;
   void ChooseGameInZipArchive(std::string *chosen_game, bool *missing_parent_roms, const ZipArchive &zip, const std::string &zipfilename) const;
-  bool LoadRegion(ROM *buffer, const GameLoader::Region::ptr_t &region, const ZipArchive &zip) const;
-  bool LoadROMs(ROMSet *rom_set, const std::string &game_name, const ZipArchive &zip) const;
+
+  // Single file to be decompressed into a ROM region
+  struct LoadJob
+  {
+    ROM *rom;
+    Region::ptr_t region;
+    File::ptr_t file;
+    const ZippedFile *zipped_file;
+    bool error = false;
+  };
+  static void LoadFiles(std::vector<LoadJob> *jobs, const ZipArchive &zip, unsigned num_threads);
+  std::string GetROMCacheManifest(const std::string &game_name, const RegionsByName_t &regions_by_name, const ROMSet &rom_set, const std::map<std::string, unsigned> &word_size_by_region, const std::vector<LoadJob> &jobs) const;
+  static void LoadROMCache(std::set<std::string> *cached_regions, ROMSet *rom_set, const std::string &cache_filename, const std::string &manifest);
+  static void SaveROMCache(const ROMSet &rom_set, const std::map<std::string, unsigned> &word_size_by_region, const std::string &cache_filename, const std::string &manifest);
+  bool LoadROMs(ROMSet *rom_set, const std::string &game_name, const ZipArchive &zip, const ROMDestinationFn &destination, const std::string &cache_dir) const;
+  bool OpenGame(Game *game, ZipArchive *zip, const std::string &zipfilename) const;
 
 public:
   GameLoader(const std::string &xml_file);
-  bool Load(Game *game, ROMSet *rom_set, const std::string &zipfilename) const;
+
+  // Determines which game a zip file holds without loading any ROMs
+  bool Identify(Game *game, const std::string &zipfilename) const;
+
+  // Loads the game's ROMs. If destination is given, it is asked for each
+  // region and may place the region directly in emulator memory. Regions
+  // placed there are cached in cache_dir, if not empty.
+  bool Load(Game *game, ROMSet *rom_set, const std::string &zipfilename, const ROMDestinationFn &destination = ROMDestinationFn(), const std::string &cache_dir = std::string()) const;
   const std::map<std::string, Game> &GetGames() const
   {
     return m_game_info_by_game;
@@ -1083,7 +1083,6 @@ void CLegacy3D::AttachMemory(const UINT32 *cullingRAMLoPtr, const UINT32 *cullin
   polyRAM = polyRAMPtr;
   vrom = vromPtr;
   textureRAM = textureRAMPtr;
-  DebugLog("Legacy3D attached Real3D memory regions\n");
 }
 
 void CLegacy3D::SetStepping(int stepping)
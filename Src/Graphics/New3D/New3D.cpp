@@ -28,6 +28,7 @@
 #include <unordered_map>
 #include "R3DFloat.h"
 #include "Util/BitCast.h"
+#include "OSD/Logger.h"
 
 #define MAX_RAM_VERTS 300000
 #define MAX_ROM_VERTS 1500000
@@ -76,6 +77,17 @@ CNew3D::CNew3D(const Util::Config::Node &config, const std::string& gameName) :
 	m_wideScreen = config["WideScreen"].ValueAs<bool>();
 	m_noWhiteFlash = config["NoWhiteFlash"].ValueAs<bool>();
 
+	if (config["TexturePBO"].ValueAs<bool>()) {
+		// 4 segments of 4MB, a whole level 0 bank fits in one
+		if (m_pixelBuffers.Create(16 * 1024 * 1024, 4)) {
+			m_textureBank[0].AttachPixelBuffers(&m_pixelBuffers);
+			m_textureBank[1].AttachPixelBuffers(&m_pixelBuffers);
+		}
+		else {
+			InfoLog("Persistent pixel buffers are not supported, uploading textures directly.");
+		}
+	}
+
 	m_r3dShader.LoadShader();
 	glUseProgram(0);
 
@@ -148,6 +160,8 @@ void CNew3D::SetStepping(int stepping)
 		m_vertexFactor = (1.0f / 128.0f);		// 17.7
 		m_textureNPFactor = (1.0f / 4096.0f);	// 12.12
 	}
+
+	m_modelCache.clear();						// cached vertices were built with the old factors
 }
 
 Result CNew3D::Init(unsigned xOffset, unsigned yOffset, unsigned xRes, unsigned yRes, unsigned totalXResParam, unsigned totalYResParam, unsigned aaTarget)
@@ -344,56 +358,86 @@ void CNew3D::DrawAmbientFog()
 	}
 }
 
-bool CNew3D::RenderScene(int priority, bool renderOverlay, Layer layer)
+void CNew3D::BuildDrawLists()
 {
-	glActiveTexture(GL_TEXTURE0);
-	m_textureBank[0].Bind();
-	glActiveTexture(GL_TEXTURE1);
-	m_textureBank[1].Bind();
-	glActiveTexture(GL_TEXTURE0);
+	for (auto &pri : m_drawLists) {
+		for (auto &overlay : pri) {
+			for (auto &list : overlay) {
+				list.clear();
+			}
+		}
+	}
 
-	bool hasOverlay = false;		// (high priority polys)
+	for (auto &hasOverlay : m_hasOverlay) {
+		hasOverlay = false;
+	}
 
-	for (auto &n : m_nodes) {
+	static constexpr Layer layers[] = { Layer::colour, Layer::trans1, Layer::trans2 };
 
-		if (n.viewport.priority != priority || n.models.empty()) {
-			continue;
-		}
+	UINT32 meshes = 0;
 
-		CalcViewport(&n.viewport);
-		glViewport(n.viewport.x, n.viewport.y, n.viewport.width, n.viewport.height);
+	for (auto &n : m_nodes) {
 
-		m_r3dShader.SetViewportUniforms(&n.viewport);
+		int priority = n.viewport.priority;
 
 		for (auto &m : n.models) {
 
-			bool matrixLoaded = false;
-
-			if (m.meshes->empty()) {
-				continue;
-			}
-
 			for (auto &mesh : *m.meshes) {
 
 				if (mesh.highPriority) {
-					hasOverlay = true;
+					m_hasOverlay[priority] = true;
 				}
 
-				if (!mesh.Render(layer, m.alpha)) continue;
-				if (mesh.highPriority != renderOverlay) continue;
-
-				if (!matrixLoaded) {
-					m_r3dShader.SetModelStates(&m);
-					matrixLoaded = true;		// do this here to stop loading matrices we don't need. Ie when rendering non transparent etc
+				for (int i = 0; i < 3; i++) {
+					if (mesh.Render(layers[i], m.alpha)) {
+						m_drawLists[priority][mesh.highPriority][i].push_back({ &n, &m, &mesh });
+					}
 				}
-				
-				m_r3dShader.SetMeshUniforms(&mesh);
-				glDrawArrays(m_primType, mesh.vboOffset, mesh.vertexCount);
+
+				meshes++;
 			}
 		}
 	}
 
-	return hasOverlay;
+	m_drawCounts.meshes	= meshes;
+	m_drawCounts.drawn	= 0;
+}
+
+bool CNew3D::RenderScene(int priority, bool renderOverlay, Layer layer)
+{
+	glActiveTexture(GL_TEXTURE0);
+	m_textureBank[0].Bind();
+	glActiveTexture(GL_TEXTURE1);
+	m_textureBank[1].Bind();
+	glActiveTexture(GL_TEXTURE0);
+
+	const auto &drawList = m_drawLists[priority][renderOverlay][(int)layer];
+
+	Node* currentNode = nullptr;
+	Model* currentModel = nullptr;
+
+	for (const auto &d : drawList) {
+
+		if (d.node != currentNode) {
+			CalcViewport(&d.node->viewport);
+			glViewport(d.node->viewport.x, d.node->viewport.y, d.node->viewport.width, d.node->viewport.height);
+
+			m_r3dShader.SetViewportUniforms(&d.node->viewport);
+			currentNode = d.node;
+		}
+
+		if (d.model != currentModel) {
+			m_r3dShader.SetModelStates(d.model);
+			currentModel = d.model;
+		}
+
+		m_r3dShader.SetMeshUniforms(d.mesh);
+		glDrawArrays(m_primType, d.mesh->vboOffset, d.mesh->vertexCount);
+	}
+
+	m_drawCounts.drawn += (UINT32)drawList.size();
+
+	return m_hasOverlay[priority];		// (high priority polys)
 }
 
 bool CNew3D::SkipLayer(int layer)
@@ -451,6 +495,19 @@ void CNew3D::RenderFrame(void)
 
 	// release any resources from last frame
 	m_polyBufferRam.clear();		// clear dynamic model memory buffer
+	m_frameCount++;
+
+	// drop cached models that haven't been drawn for a while
+	if ((m_frameCount % 60) == 0) {
+		for (auto it = m_modelCache.begin(); it != m_modelCache.end();) {
+			if (m_frameCount - it->second.frame > 60) {
+				it = m_modelCache.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
 	m_nodes.clear();				// memory will grow during the object life time, that's fine, no need to shrink to fit
 	m_modelMat.Release();			// would hope we wouldn't need this but no harm in checking
 	m_nodeAttribs.Reset();
@@ -473,6 +530,7 @@ void CNew3D::RenderFrame(void)
 	}
 
 	RenderViewport(0x800000);						// build model structure
+	BuildDrawLists();
 	
 	m_vbo.Bind(true);
 	m_vbo.BufferSubData(MAX_ROM_VERTS*sizeof(FVertex), m_polyBufferRam.size()*sizeof(FVertex), m_polyBufferRam.data());	// upload all the dynamic data to GPU in one go
@@ -558,6 +616,8 @@ void CNew3D::RenderFrame(void)
 	if (m_aaTarget) {
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
+
+	m_drawListStats = m_drawCounts;
 }
 
 void CNew3D::BeginFrame(void)
@@ -631,7 +691,7 @@ bool CNew3D::DrawModel(UINT32 modelAddr)
 		m->dynamic = false;
 	}
 	else {
-		m->meshes = std::make_shared<std::vector<Mesh>>();
+		cached = FindCachedModel(modelAddr, modelAddress, m);
 	}
 
 	// copy current model matrix
@@ -647,12 +707,128 @@ bool CNew3D::DrawModel(UINT32 modelAddr)
 	m->alpha			= m_nodeAttribs.currentModelAlpha;
 
 	if (!cached) {
-		CacheModel(m, modelAddress);
+		if (m->dynamic) {
+			Vertex prevIn[4];
+			UINT16 prevTexCoordsIn[4][2];
+			memcpy(prevIn, m_prev, sizeof(prevIn));
+			memcpy(prevTexCoordsIn, m_prevTexCoords, sizeof(prevTexCoordsIn));
+
+			size_t firstVert = m_polyBufferRam.size();
+			m->meshes = std::make_shared<std::vector<Mesh>>();
+			CacheModel(m, modelAddress);
+			StoreCachedModel(modelAddr, modelAddress, m, firstVert, prevIn, prevTexCoordsIn);
+		}
+		else {
+			CacheModel(m, modelAddress);
+		}
 	}
 
 	return true;
 }
 
+bool CNew3D::FindCachedModel(UINT32 modelAddr, const UINT32 *data, Model *m)
+{
+	auto it = m_modelCache.find(modelAddr);
+	if (it == m_modelCache.end() || data == nullptr) {
+		return false;
+	}
+
+	CachedModel& c = it->second;
+
+	if (memcmp(c.data.data(), data, c.data.size() * sizeof(UINT32))) {
+		return false;
+	}
+
+	// the same model can be drawn under different colour tables
+	if (!c.colourAddr.empty() && c.colourTableAddr != m_colorTableAddr) {
+		return false;
+	}
+
+	for (size_t i = 0; i < c.colourAddr.size(); i++) {
+		if (m_polyRAM[c.colourAddr[i]] != c.colourValue[i]) {
+			return false;
+		}
+	}
+
+	if (c.sharesPrev && (memcmp(c.prevIn, m_prev, sizeof(m_prev)) || memcmp(c.prevTexCoordsIn, m_prevTexCoords, sizeof(m_prevTexCoords)))) {
+		return false;
+	}
+
+	// first use this frame, copy the vertices in. Drawn again in the same frame it can share them
+	if (c.frame != m_frameCount) {
+
+		int vboOffset = (int)m_polyBufferRam.size() + MAX_ROM_VERTS;
+
+		m_polyBufferRam.insert(m_polyBufferRam.end(), c.verts.begin(), c.verts.end());
+
+		// last frame's models are gone, so nothing else is looking at these meshes
+		if (vboOffset != c.vboOffset) {
+			for (auto& mesh : *c.meshes) {
+				mesh.vboOffset += vboOffset - c.vboOffset;
+			}
+			c.vboOffset = vboOffset;
+		}
+
+		c.frame = m_frameCount;
+	}
+
+	memcpy(m_prev, c.prevOut, sizeof(m_prev));
+	memcpy(m_prevTexCoords, c.prevTexCoordsOut, sizeof(m_prevTexCoords));
+
+	m->meshes = c.meshes;
+
+	return true;
+}
+
+void CNew3D::StoreCachedModel(UINT32 modelAddr, const UINT32 *data, const Model *m, size_t firstVert, const Vertex prevIn[4], const UINT16 prevTexCoordsIn[4][2])
+{
+	if (data == nullptr) {
+		return;
+	}
+
+	CachedModel& c = m_modelCache[modelAddr];
+
+	c.colourTableAddr = m_colorTableAddr;
+	c.colourAddr.clear();
+	c.colourValue.clear();
+
+	// walk the polys the same way CacheModel did to find the extent of the model and its colour reads
+	PolyHeader ph((UINT32*)data);
+	const UINT32* end;
+
+	c.sharesPrev = ph.header[6] != 0 && ph.NumSharedVerts() != 0;
+
+	while (true) {
+
+		if (ph.header[6] == 0) {
+			end = ph.header + 7;
+			break;
+		}
+
+		if (!ph.PolyColor()) {
+			c.colourAddr.push_back(m_colorTableAddr + ph.ColorIndex());
+			c.colourValue.push_back(m_polyRAM[c.colourAddr.back()]);
+		}
+
+		if (!ph.NextPoly()) {
+			end = ph.StartOfData() + (ph.NumVerts() - ph.NumSharedVerts()) * 4;
+			break;
+		}
+	}
+
+	c.data.assign(data, end);
+
+	memcpy(c.prevIn, prevIn, sizeof(c.prevIn));
+	memcpy(c.prevTexCoordsIn, prevTexCoordsIn, sizeof(c.prevTexCoordsIn));
+	memcpy(c.prevOut, m_prev, sizeof(c.prevOut));
+	memcpy(c.prevTexCoordsOut, m_prevTexCoords, sizeof(c.prevTexCoordsOut));
+
+	c.verts.assign(m_polyBufferRam.begin() + firstVert, m_polyBufferRam.end());
+	c.meshes	= m->meshes;
+	c.vboOffset	= (int)firstVert + MAX_ROM_VERTS;
+	c.frame		= m_frameCount;
+}
+
 /*
 	0x00:   x------- -------- -------- --------	Is UF ref
 			-x------ -------- -------- --------	Is 3D model
@@ -1698,6 +1874,11 @@ float CNew3D::GetLosValue(int layer)
 	return m_losFront->value[layer];
 }
 
+CNew3D::DrawListStats CNew3D::GetDrawListStats() const
+{
+	return m_drawListStats;
+}
+
 void CNew3D::TranslateLosPosition(int inX, int inY, int& outX, int& outY) const
 {
 	// remap real3d 496x384 to our new viewport
@@ -175,6 +175,20 @@ public:
 	*/
 	float GetLosValue(int layer);
 
+	/*
+	* GetDrawListStats();
+	*
+	* Number of meshes sorted into draw lists and number of draw calls issued
+	* for the last frame. For debugging.
+	*/
+	struct DrawListStats
+	{
+		UINT32 meshes;
+		UINT32 drawn;
+	};
+
+	DrawListStats GetDrawListStats() const;
+
 	/*
 	* CRender3D(config):
 	* ~CRender3D(void):
@@ -212,9 +226,12 @@ private:
 	int	GetTexFormat(int originalFormat, bool contour) const;
 	void SetMeshValues(SortingMesh *currentMesh, PolyHeader &ph);
 	void CacheModel(Model *m, const UINT32 *data);
+	bool FindCachedModel(UINT32 modelAddr, const UINT32 *data, Model *m);
+	void StoreCachedModel(UINT32 modelAddr, const UINT32 *data, const Model *m, size_t firstVert, const Vertex prevIn[4], const UINT16 prevTexCoordsIn[4][2]);
 	void CopyVertexData(const R3DPoly& r3dPoly, std::vector<FVertex>& vertexArray);
 	void GetCoordinates(int width, int height, UINT16 uIn, UINT16 vIn, float uvScale, float& uOut, float& vOut) const;
 
+	void BuildDrawLists();
 	bool RenderScene(int priority, bool renderOverlay, Layer layer);		// returns if has overlay plane
 	bool IsDynamicModel(UINT32 *data) const;				// check if the model has a colour palette
 	bool IsVROMModel(UINT32 modelAddr) const;
@@ -286,8 +303,45 @@ private:
 	std::vector<FVertex> m_polyBufferRam;		// dynamic polys
 	std::vector<FVertex> m_polyBufferRom;		// rom polys
 	std::unordered_map<UINT32, std::shared_ptr<std::vector<Mesh>>> m_romMap;	// a hash table for all the ROM models. The meshes don't have model matrices or tex offsets yet
+
+	// Models built from memory that can change (polygon RAM, or VROM with a colour table). These are
+	// rebuilt every frame, so we keep the last result along with everything it was built from and
+	// reuse it while none of that has changed.
+	struct CachedModel
+	{
+		std::vector<UINT32>	data;						// model words
+		UINT32				colourTableAddr = 0;		// colour table base the model was built under
+		std::vector<UINT32>	colourAddr;					// colour table entries read, and their values
+		std::vector<UINT32>	colourValue;
+		bool				sharesPrev = false;			// first poly reuses vertices from the previous model
+		Vertex				prevIn[4];
+		UINT16				prevTexCoordsIn[4][2];
+		Vertex				prevOut[4];
+		UINT16				prevTexCoordsOut[4][2];
+		std::vector<FVertex> verts;						// vertices for all meshes, in order
+		std::shared_ptr<std::vector<Mesh>> meshes;
+		int					vboOffset	= 0;			// where verts start in the vbo for frame 'frame'
+		UINT32				frame		= 0;
+	};
+
+	std::unordered_map<UINT32, CachedModel> m_modelCache;
+	UINT32 m_frameCount = 0;
+	PixelBufferRing		m_pixelBuffers;			// optional streaming buffer for texture uploads
 	TextureBank			m_textureBank[2];
 
+	// meshes to draw for each priority, overlay and layer (colour, trans1, trans2), in scene order
+	struct DrawCall
+	{
+		Node*	node;
+		Model*	model;
+		Mesh*	mesh;
+	};
+
+	std::vector<DrawCall> m_drawLists[4][2][3];
+	bool m_hasOverlay[4] = {};
+	DrawListStats m_drawCounts = {};
+	std::atomic<DrawListStats> m_drawListStats{ DrawListStats() };	// last complete frame, read from other threads
+
 	GLuint m_vao;
 	VBO m_vbo;								// large VBO to hold our poly data, start of VBO is ROM data, ram polys follow
 	R3DShader m_r3dShader;
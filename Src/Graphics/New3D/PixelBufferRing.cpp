@@ -0,0 +1,127 @@
+#include "PixelBufferRing.h"
+#include <cstring>
+
+New3D::PixelBufferRing::PixelBufferRing()
+{
+}
+
+New3D::PixelBufferRing::~PixelBufferRing()
+{
+	Destroy();
+}
+
+bool New3D::PixelBufferRing::Create(GLsizeiptr size, int numSegments)
+{
+	Destroy();
+
+	if (!GLEW_ARB_buffer_storage || numSegments < 1 || numSegments > MaxSegments) {
+		return false;
+	}
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &m_id);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_id);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+	m_mapped = (UINT8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!m_mapped) {
+		Destroy();
+		return false;
+	}
+
+	m_numSegments	= numSegments;
+	m_segmentSize	= size / numSegments;
+	m_segment		= 0;
+	m_offset		= 0;
+
+	return true;
+}
+
+void New3D::PixelBufferRing::Destroy()
+{
+	for (auto& fence : m_fences) {
+		if (fence) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	if (m_id) {
+		if (m_mapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_id);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &m_id);
+	}
+
+	m_id			= 0;
+	m_mapped		= nullptr;
+	m_numSegments	= 0;
+	m_segmentSize	= 0;
+}
+
+bool New3D::PixelBufferRing::IsValid() const
+{
+	return m_mapped != nullptr;
+}
+
+void New3D::PixelBufferRing::NextSegment()
+{
+	// everything read from the current segment has been submitted by now, so fence it
+	if (m_fences[m_segment]) {
+		glDeleteSync(m_fences[m_segment]);
+	}
+	m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_segment	= (m_segment + 1) % m_numSegments;
+	m_offset	= 0;
+
+	// wait until the gpu has finished with the last data written here
+	GLsync fence = m_fences[m_segment];
+	if (fence) {
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+		}
+		glDeleteSync(fence);
+		m_fences[m_segment] = nullptr;
+	}
+}
+
+GLintptr New3D::PixelBufferRing::Write(const UINT16* src, int pitch, int width, int height)
+{
+	const GLsizeiptr rowSize	= (GLsizeiptr)width * sizeof(UINT16);
+	const GLsizeiptr size		= (rowSize * height + 15) & ~(GLsizeiptr)15;
+
+	if (!m_mapped || size > m_segmentSize) {
+		return -1;
+	}
+
+	if (m_offset + size > m_segmentSize) {
+		NextSegment();
+	}
+
+	const GLintptr offset = m_segment * m_segmentSize + m_offset;
+	UINT8* dst = m_mapped + offset;
+
+	if (width == pitch) {
+		memcpy(dst, src, rowSize * height);
+	}
+	else {
+		for (int i = 0; i < height; i++) {
+			memcpy(dst, src, rowSize);
+			dst += rowSize;
+			src += pitch;
+		}
+	}
+
+	m_offset += size;
+
+	return offset;
+}
+
+void New3D::PixelBufferRing::Bind(bool enable)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, enable ? m_id : 0);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef _PIXELBUFFERRING_H_
+#define _PIXELBUFFERRING_H_
+
+#include "Types.h"
+#include <GL/glew.h>
+
+// A persistently mapped pixel unpack buffer used as a streaming ring for texture uploads.
+// Texture data is copied straight into buffer memory and the driver reads it from there
+// asynchronously. The ring is split into segments, each guarded by a fence, so we only ever
+// wait on the GPU if it is still reading data written a whole ring ago.
+
+namespace New3D {
+
+	class PixelBufferRing
+	{
+	public:
+		PixelBufferRing();
+		~PixelBufferRing();
+
+		bool Create(GLsizeiptr size, int numSegments);	// fails if persistent mapping isn't supported
+		void Destroy();
+		bool IsValid() const;
+
+		// copies a rectangle of 16bit texels (pitch in texels) into the ring
+		// returns the buffer offset to upload from, or -1 if the rectangle is too large
+		GLintptr Write(const UINT16* src, int pitch, int width, int height);
+		void Bind(bool enable);
+
+	private:
+		void NextSegment();
+
+		static constexpr int MaxSegments = 8;
+
+		GLuint m_id = 0;
+		UINT8* m_mapped = nullptr;
+		GLsizeiptr m_segmentSize = 0;
+		int m_numSegments = 0;
+		int m_segment = 0;
+		GLsizeiptr m_offset = 0;	// write position within the current segment
+		GLsync m_fences[MaxSegments] = {};
+	};
+
+}
+
+#endif
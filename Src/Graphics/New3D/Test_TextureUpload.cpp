@@ -0,0 +1,156 @@
+#include "TextureBank.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Times texture sheet uploads with one call per row, one call per rectangle and through the
+// pixel buffer ring. Runs without a window on an EGL surfaceless context, eg. Mesa llvmpipe:
+//   LIBGL_ALWAYS_SOFTWARE=1 EGL_PLATFORM=surfaceless ./Test_TextureUpload
+
+static bool CreateContext()
+{
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay display = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		return false;
+	}
+
+	static const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+	eglBindAPI(EGL_OPENGL_API);
+
+	static const EGLint contextAttribs[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 1, EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+	EGLContext context = eglCreateContext(display, numConfigs ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		return false;
+	}
+
+	glewExperimental = GL_TRUE;
+	glewInit();		// complains about GLX under EGL, but the GL entry points are loaded
+	return GLEW_VERSION_3_0 != 0;
+}
+
+struct Rect
+{
+	int level, x, y, width, height;
+};
+
+static const int mipXBase[] = { 0, 1024, 1536, 1792, 1920, 1984, 2016, 2032, 2040, 2044, 2046, 2047 };
+static const int mipYBase[] = { 0, 512, 768, 896, 960, 992, 1008, 1016, 1020, 1022, 1023 };
+
+// what CNew3D::UploadTextures did for each rectangle before
+static void UploadPerRow(GLuint texID, const UINT16* textureRam, const Rect& r)
+{
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	for (int i = 0; i < r.height; i++) {
+		glTexSubImage2D(GL_TEXTURE_2D, r.level, r.x - mipXBase[r.level], r.y - mipYBase[r.level] + i, r.width, 1, GL_RED_INTEGER, GL_UNSIGNED_SHORT, textureRam + ((r.y + i) * 2048) + r.x);
+	}
+}
+
+template <typename F>
+static double Time(int repeats, F f)
+{
+	glFinish();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < repeats; i++) {
+		f();
+	}
+	glFinish();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+}
+
+int main(int argc, char **argv)
+{
+	if (!CreateContext()) {
+		std::cout << "Unable to create an OpenGL context." << std::endl;
+		return 1;
+	}
+
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+	std::vector<UINT16> textureRam(2048 * 1024);
+	srand(1234);
+	for (auto& texel : textureRam) {
+		texel = UINT16(rand());
+	}
+
+	// a typical frame's worth of small texture writes
+	std::vector<Rect> small;
+	for (int i = 0; i < 256; i++) {
+		int size = 8 << (rand() % 4);
+		small.push_back({ 0, (rand() % (2048 / size)) * size, (rand() % (1024 / size)) * size, size, size });
+	}
+
+	New3D::PixelBufferRing pixelBuffers;
+	bool havePBO = pixelBuffers.Create(16 * 1024 * 1024, 4);
+
+	New3D::TextureBank reference;
+	New3D::TextureBank direct;
+	New3D::TextureBank streamed;
+	reference.AttachMemory(textureRam.data());
+	direct.AttachMemory(textureRam.data());
+	streamed.AttachMemory(textureRam.data());
+	streamed.AttachPixelBuffers(&pixelBuffers);
+
+	// full sheet invalidation, every level of the bank
+	std::vector<Rect> sheet;
+	for (int level = 0, width = 2048, height = 1024; level < reference.GetNumberOfLevels(); level++) {
+		sheet.push_back({ level, mipXBase[level], mipYBase[level], width, height });
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+
+	GLuint refID;
+	reference.Bind();
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&refID);
+
+	const struct { const char* name; const std::vector<Rect>& rects; int repeats; } tests[] = {
+		{ "full sheet", sheet, 10 },
+		{ "256 small rects", small, 50 },
+	};
+
+	for (const auto& test : tests) {
+		double perRow = Time(test.repeats, [&] { for (const auto& r : test.rects) UploadPerRow(refID, textureRam.data(), r); });
+		double single = Time(test.repeats, [&] { for (const auto& r : test.rects) direct.UploadTextures(r.level, r.x, r.y, r.width, r.height); });
+		std::cout << test.name << ": per row " << perRow << " ms, single call " << single << " ms";
+		if (havePBO) {
+			double pbo = Time(test.repeats, [&] { for (const auto& r : test.rects) streamed.UploadTextures(r.level, r.x, r.y, r.width, r.height); });
+			std::cout << ", pixel buffer ring " << pbo << " ms";
+		}
+		std::cout << std::endl;
+	}
+
+	if (!havePBO) {
+		std::cout << "Persistent pixel buffers are not supported." << std::endl;
+	}
+
+	// all three paths must leave identical texture contents
+	size_t numFailed = 0;
+	for (int level = 0, width = 2048, height = 1024; level < reference.GetNumberOfLevels(); level++) {
+		std::vector<UINT16> expected(width * height), result(width * height);
+		glPixelStorei(GL_PACK_ALIGNMENT, 2);
+		reference.Bind();
+		glGetTexImage(GL_TEXTURE_2D, level, GL_RED_INTEGER, GL_UNSIGNED_SHORT, expected.data());
+		for (auto* bank : { &direct, &streamed }) {
+			bank->Bind();
+			glGetTexImage(GL_TEXTURE_2D, level, GL_RED_INTEGER, GL_UNSIGNED_SHORT, result.data());
+			if (result != expected && (bank != &streamed || havePBO)) {
+				std::cout << "Level " << level << " FAILED. " << (bank == &direct ? "Single call" : "Pixel buffer") << " upload differs." << std::endl;
+				numFailed++;
+			}
+		}
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+
+	if (numFailed == 0)
+		std::cout << "All tests passed!" << std::endl;
+	return numFailed != 0;
+}
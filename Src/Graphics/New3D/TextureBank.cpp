@@ -44,6 +44,11 @@ void New3D::TextureBank::AttachMemory(const UINT16* textureRam)
 	m_textureRam = textureRam;
 }
 
+void New3D::TextureBank::AttachPixelBuffers(PixelBufferRing* pixelBuffers)
+{
+	m_pixelBuffers = pixelBuffers;
+}
+
 void New3D::TextureBank::Bind()
 {
 	glBindTexture(GL_TEXTURE_2D, m_texID);
@@ -60,9 +65,22 @@ void New3D::TextureBank::UploadTextures(int level, int x, int y, int width, int
 	int subX = x - mipXBase[level];
 	int subY = y - mipYBase[level];
 
-	for (int i = 0; i < height; i++) {
-		glTexSubImage2D(GL_TEXTURE_2D, level, subX, subY + i, width, 1, GL_RED_INTEGER, GL_UNSIGNED_SHORT, m_textureRam + ((y + i) * 2048) + x);
+	const UINT16* src = m_textureRam + (y * 2048) + x;
+
+	if (m_pixelBuffers && m_pixelBuffers->IsValid()) {
+		GLintptr offset = m_pixelBuffers->Write(src, 2048, width, height);
+		if (offset >= 0) {
+			m_pixelBuffers->Bind(true);
+			glTexSubImage2D(GL_TEXTURE_2D, level, subX, subY, width, height, GL_RED_INTEGER, GL_UNSIGNED_SHORT, (const void*)offset);
+			m_pixelBuffers->Bind(false);
+			return;
+		}
 	}
+
+	// the source is a 2048 wide sheet, so the whole rectangle can go in one call
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
+	glTexSubImage2D(GL_TEXTURE_2D, level, subX, subY, width, height, GL_RED_INTEGER, GL_UNSIGNED_SHORT, src);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
 int New3D::TextureBank::GetNumberOfLevels() const
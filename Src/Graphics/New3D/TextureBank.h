@@ -4,6 +4,7 @@
 #define _TEXTUREBANK_H_
 
 #include "Types.h"
+#include "PixelBufferRing.h"
 #include <GL/glew.h>
 
 // texture banks are a fixed size
@@ -18,12 +19,14 @@ namespace New3D {
 		~TextureBank();
 
 		void AttachMemory(const UINT16* textureRam);
+		void AttachPixelBuffers(PixelBufferRing* pixelBuffers);	// optional, uploads go through the ring if valid
 		void Bind();
 		void UploadTextures(int level, int x, int y, int width, int height);
 		int GetNumberOfLevels() const;
 
 	private:
 		const UINT16* m_textureRam = nullptr;
+		PixelBufferRing* m_pixelBuffers = nullptr;
 		GLuint m_texID = 0;
 		int m_numLevels = 0;
 	};
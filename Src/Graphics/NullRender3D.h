@@ -0,0 +1,56 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2003-2026 The Supermodel Team
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/*
+ * NullRender3D.h
+ *
+ * Header file defining the CNullRender3D class: a Real3D renderer that draws
+ * nothing.
+ */
+
+#ifndef INCLUDED_NULLRENDER3D_H
+#define INCLUDED_NULLRENDER3D_H
+
+#include "IRender3D.h"
+
+/*
+ * CNullRender3D:
+ *
+ * Real3D renderer that draws nothing and needs no GL context. Used to run
+ * the emulator headless. Line-of-sight queries always report 0, since there
+ * is no depth buffer to read them from.
+ */
+class CNullRender3D: public IRender3D
+{
+public:
+  void RenderFrame(void) {}
+  void BeginFrame(void) {}
+  void EndFrame(void) {}
+  void UploadTextures(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height) {}
+  void AttachMemory(const uint32_t *cullingRAMLoPtr, const uint32_t *cullingRAMHiPtr, const uint32_t *polyRAMPtr, const uint32_t *vromPtr, const uint16_t *textureRAMPtr) {}
+  void SetStepping(int stepping) {}
+  Result Init(unsigned xOffset, unsigned yOffset, unsigned xRes, unsigned yRes, unsigned totalXRes, unsigned totalYRes, unsigned aaTarget) { return Result::OKAY; }
+  void SetSunClamp(bool enable) {}
+  void SetBlockCulling(bool enable) {}
+  float GetLosValue(int layer) { return 0.0f; }
+};
+
+#endif  // INCLUDED_NULLRENDER3D_H
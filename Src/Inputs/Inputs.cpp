@@ -87,6 +87,8 @@ CInputs::CInputs(std::shared_ptr<CInputSystem> system)
 	uiSaveState = AddSwitchInput("UISaveState", "Save State", Game::INPUT_COMMON, "KEY_F5");
 	uiChangeSlot = AddSwitchInput("UIChangeSlot", "Change Save Slot", Game::INPUT_COMMON, "KEY_F6");
 	uiLoadState = AddSwitchInput("UILoadState", "Load State", Game::INPUT_COMMON, "KEY_F7");
+	uiRewind = AddSwitchInput("UIRewind", "Rewind (Hold)", Game::INPUT_COMMON, "KEY_BACKSPACE");
+	uiFastForward = AddSwitchInput("UIFastForward", "Fast-Forward (Hold)", Game::INPUT_COMMON, "KEY_TAB");
 	uiMusicVolUp = AddSwitchInput("UIMusicVolUp", "Increase Music Volume", Game::INPUT_UI, "KEY_F10");
 	uiMusicVolDown = AddSwitchInput("UIMusicVolDown", "Decrease Music Volume", Game::INPUT_UI, "KEY_F9");
 	uiSoundVolUp = AddSwitchInput("UISoundVolUp", "Increase Sound Volume", Game::INPUT_UI, "KEY_F12");
@@ -314,11 +316,23 @@ CInputs::~CInputs()
 {
 }
 
+void CInputs::AddSlot(std::shared_ptr<CInput> input)
+{
+	// Poll() の特別扱いはここで一度だけ判定しておく（毎フレームの strcmp を避ける）
+	uint8_t flags = 0;
+	if (strcmp(input->id, "Exit UI") == 0)
+		flags |= SLOT_EXIT_UI;
+	if (strcmp(input->id, "Load State") == 0)
+		flags |= SLOT_LOAD_STATE;
+	m_inputs.push_back(input);
+	m_slotFlags.push_back(flags);
+}
+
 std::shared_ptr<CSwitchInput> CInputs::AddSwitchInput(const char *id, const char *label, unsigned gameFlags, const char *defaultMapping,
 													  UINT16 offVal, UINT16 onVal)
 {
 	auto input = std::shared_ptr<CSwitchInput>(new CSwitchInput(id, label, gameFlags, defaultMapping, offVal, onVal));
-	m_inputs.push_back(input);
+	AddSlot(input);
 	return input;
 }
 
@@ -326,7 +340,7 @@ std::shared_ptr<CAnalogInput> CInputs::AddAnalogInput(const char *id, const char
 													  UINT16 minVal, UINT16 maxVal)
 {
 	auto input = std::shared_ptr<CAnalogInput>(new CAnalogInput(id, label, gameFlags, defaultMapping, minVal, maxVal));
-	m_inputs.push_back(input);
+	AddSlot(input);
 	return input;
 }
 
@@ -334,7 +348,7 @@ std::shared_ptr<CAxisInput> CInputs::AddAxisInput(const char *id, const char *la
 												  std::shared_ptr<CAnalogInput> axisNeg, std::shared_ptr<CAnalogInput> axisPos, UINT16 minVal, UINT16 offVal, UINT16 maxVal)
 {
 	auto input = std::shared_ptr<CAxisInput>(new CAxisInput(id, label, gameFlags, defaultMapping, axisNeg, axisPos, minVal, offVal, maxVal));
-	m_inputs.push_back(input);
+	AddSlot(input);
 	return input;
 }
 
@@ -342,7 +356,7 @@ std::shared_ptr<CGearShift4Input> CInputs::AddGearShift4Input(const char *id, co
 															  std::shared_ptr<CSwitchInput> shift1, std::shared_ptr<CSwitchInput> shift2, std::shared_ptr<CSwitchInput> shift3, std::shared_ptr<CSwitchInput> shift4, std::shared_ptr<CSwitchInput> shiftN, std::shared_ptr<CSwitchInput> shiftUp, std::shared_ptr<CSwitchInput> shiftDown)
 {
 	auto input = std::shared_ptr<CGearShift4Input>(new CGearShift4Input(id, label, gameFlags, shift1, shift2, shift3, shift4, shiftN, shiftUp, shiftDown));
-	m_inputs.push_back(input);
+	AddSlot(input);
 	return input;
 }
 
@@ -350,7 +364,7 @@ std::shared_ptr<CTriggerInput> CInputs::AddTriggerInput(const char *id, const ch
 														std::shared_ptr<CSwitchInput> _trigger, std::shared_ptr<CSwitchInput> offscreen, UINT16 offVal, UINT16 onVal)
 {
 	auto input = std::shared_ptr<CTriggerInput>(new CTriggerInput(id, label, gameFlags, _trigger, offscreen, offVal, onVal));
-	m_inputs.push_back(input);
+	AddSlot(input);
 	return input;
 }
 
@@ -812,17 +826,9 @@ bool CInputs::Poll(const Game *game, unsigned dispX, unsigned dispY, unsigned di
 	}
 
 	// --- 開始時のカウンタリセット ---
-	static bool s_wasPlaying = false;
+	// （再生側は ReplayPlayer::Start / Seek がカウンタを合わせる）
 	static bool s_wasRecording = false;
 
-	if (ReplayPlayer::IsPlaying() && !s_wasPlaying)
-	{
-		g_frameCounter = 0;
-		s_wasPlaying = true;
-	}
-	if (!ReplayPlayer::IsPlaying())
-		s_wasPlaying = false;
-
 	if (ReplayRecorder::IsRecording() && !s_wasRecording)
 	{
 		g_frameCounter = 0;
@@ -837,14 +843,17 @@ bool CInputs::Poll(const Game *game, unsigned dispX, unsigned dispY, unsigned di
 		ReplayPlayer::UpdateState(g_frameCounter);
 	}
 
-	for (auto &it : m_inputs)
+	bool playing = ReplayPlayer::IsPlaying();
+	bool recording = ReplayRecorder::IsRecording();
+	for (size_t slot = 0; slot < m_inputs.size(); slot++)
 	{
-		CInput *in = it.get();
+		CInput *in = m_inputs[slot].get();
 
-		if (ReplayPlayer::IsPlaying())
+		if (playing)
 		{
-			in->value = ReplayPlayer::GetInputValue(in->id);
-			if (strcmp(in->id, "Exit UI") == 0 || in->IsUIInput())
+			// リプレイの値はスロット番号で引く（ID は再生開始時に解決済み）
+			in->value = ReplayPlayer::GetInputValue(unsigned(slot));
+			if ((m_slotFlags[slot] & SLOT_EXIT_UI) || in->IsUIInput())
 			{
 				in->Poll();
 			}
@@ -854,7 +863,7 @@ bool CInputs::Poll(const Game *game, unsigned dispX, unsigned dispY, unsigned di
 			in->Poll();
 
 			// ★ Xボタン (Load State) の連打・押しっぱなし防止
-			if (strcmp(in->id, "Load State") == 0)
+			if (m_slotFlags[slot] & SLOT_LOAD_STATE)
 			{
 				int currentVal = in->value; // 今の生の状態
 
@@ -871,7 +880,7 @@ bool CInputs::Poll(const Game *game, unsigned dispX, unsigned dispY, unsigned di
 				xButtonPrev = currentVal;
 			}
 
-			if (ReplayRecorder::IsRecording())
+			if (recording)
 			{
 				ReplayRecorder::Capture(g_frameCounter, in->id, in->value);
 			}
@@ -50,6 +50,19 @@ private:
   // Vector of all created inputs
   std::vector<std::shared_ptr<CInput>> m_inputs;
 
+  // Per-slot flags for the inputs Poll() treats specially, parallel to m_inputs
+  enum : uint8_t
+  {
+    SLOT_EXIT_UI    = 0x01,
+    SLOT_LOAD_STATE = 0x02
+  };
+  std::vector<uint8_t> m_slotFlags;
+
+  /*
+   * Appends an input to m_inputs and records its slot flags.
+   */
+  void AddSlot(std::shared_ptr<CInput> input);
+
   /*
    * Adds a switch input (eg button) to this collection.
    */
@@ -106,6 +119,8 @@ public:
   std::shared_ptr<CSwitchInput> uiSaveState;
   std::shared_ptr<CSwitchInput> uiChangeSlot;
   std::shared_ptr<CSwitchInput> uiLoadState;
+  std::shared_ptr<CSwitchInput> uiRewind;
+  std::shared_ptr<CSwitchInput> uiFastForward;
   std::shared_ptr<CSwitchInput> uiMusicVolUp;
   std::shared_ptr<CSwitchInput> uiMusicVolDown;
   std::shared_ptr<CSwitchInput> uiSoundVolUp;
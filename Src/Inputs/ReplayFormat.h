@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// ===== リプレイファイル共通定義 =====
+//
+// SMR1: ヘッダの後に ReplayEvent (40バイト) が全入力・全フレーム分並ぶ。
+//
+// SMR2: ヘッダの後に「変化があったフレーム」だけのグループが並ぶ。
+//       REPLAY_FLAG_ZLIB が立っていればヘッダ以降は zlib ストリーム
+//       （REPLAY_FLAG_CHUNKED の場合は後述のチャンク単位）。
+//
+//   frameDelta  varint   前のグループからのフレーム差
+//   count       varint   変化した入力の数 (0 = 記録終了フレーム)
+//   count 回:
+//     index     varint   入力番号（出現順に 0,1,2...）
+//     [name]             index が未登録の番号なら、長さ(u8) + 文字列で定義
+//     value     svarint  新しい値 (zigzag)
+//
+// 未登録の入力の値は 0 とみなす。
+//
+// REPLAY_FLAG_CHUNKED が立っている SMR2 は、ヘッダ以降がチャンクの並び:
+//
+//   type        u8       REPLAY_CHUNK_*
+//   size        u32      data のバイト数
+//   data
+//
+//   EVENTS    上記の変化グループ（ZLIB なら rawSize(u32) + zlib データ。
+//             縮まなかったチャンクは rawSize の後にそのまま格納）
+//   KEYFRAME  frame(u32), rawSize(u32), zlib 圧縮したセーブステート
+//             frame はそのフレームのイベントを反映し終えた時点の状態
+//   INDEX     lastFrame(u32), count(u32), count 回 { frame(u32), offset(u64) }
+//             offset は KEYFRAME チャンク先頭のファイル位置
+//
+// ファイル末尾には INDEX チャンクの位置 (u64) と "SMRI" が付く。
+// 録画中に落ちて末尾が無いファイルは、チャンクを先頭から辿って読める。
+
+struct ReplayHeader
+{
+    char magic[4];     // "SMR1" / "SMR2"
+    uint32_t version;  // 1 / 2
+    uint32_t flags;    // REPLAY_FLAG_*
+    uint32_t reserved; // 0
+};
+
+static const uint32_t REPLAY_FLAG_ZLIB = 1 << 0;    // イベントが zlib 圧縮
+static const uint32_t REPLAY_FLAG_CHUNKED = 1 << 1; // チャンク形式（キーフレーム付き）
+
+enum ReplayChunkType : uint8_t
+{
+    REPLAY_CHUNK_EVENTS = 1,
+    REPLAY_CHUNK_KEYFRAME = 2,
+    REPLAY_CHUNK_INDEX = 3
+};
+
+static const size_t REPLAY_CHUNK_HEADER_SIZE = 1 + 4;
+static const size_t REPLAY_TRAILER_SIZE = 8 + 4;
+
+static const size_t REPLAY_MAX_ID_LEN = 31;
+
+// ===== varint (LEB128) =====
+inline void ReplayPutVarint(std::vector<uint8_t> &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+inline void ReplayPutSVarint(std::vector<uint8_t> &out, int32_t v)
+{
+    ReplayPutVarint(out, (uint32_t(v) << 1) ^ uint32_t(v >> 31));
+}
+
+// 失敗（データ末尾）なら false
+inline bool ReplayGetVarint(const uint8_t *&p, const uint8_t *end, uint32_t &v)
+{
+    v = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7)
+    {
+        if (p >= end)
+            return false;
+        uint8_t b = *p++;
+        v |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline bool ReplayGetSVarint(const uint8_t *&p, const uint8_t *end, int32_t &v)
+{
+    uint32_t u;
+    if (!ReplayGetVarint(p, end, u))
+        return false;
+    v = int32_t(u >> 1) ^ -int32_t(u & 1);
+    return true;
+}
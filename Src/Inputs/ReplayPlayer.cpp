@@ -1,19 +1,14 @@
 #include "ReplayPlayer.h"
+#include "ReplayFormat.h"
 #include "Inputs.h"
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
 #include <unordered_map>
 #include <string>
+#include <zlib.h>
 
 // ===== フォーマット定義 =====
-struct ReplayHeader
-{
-    char magic[4];
-    uint32_t version;
-    uint32_t flags;
-    uint32_t reserved;
-};
-
 #pragma pack(push, 1)
 struct ReplayEvent
 {
@@ -23,20 +18,227 @@ struct ReplayEvent
 };
 #pragma pack(pop)
 
+// 読み込み途中のイベント（ID はファイル内の ID 表の番号）
+struct LoadedEvent
+{
+    uint32_t frame;
+    uint32_t id;
+    int32_t value;
+};
+
+static const uint32_t NO_ID = 0xFFFFFFFF; // 記録終了フレーム
+
+// キーフレームの位置（KEYFRAME チャンク先頭）
+struct KeyframeRef
+{
+    uint32_t frame;
+    uint64_t offset;
+};
+
+static std::vector<KeyframeRef> s_keyframes;
+static uint32_t s_lastFrame = 0;
+
+// Inputs.cpp の再生フレームカウンタ
+extern uint32_t g_frameCounter;
+
 // ===== 静的メンバ定義 =====
 FILE *ReplayPlayer::s_fp = nullptr;
 bool ReplayPlayer::s_playing = false;
-uint32_t ReplayPlayer::s_replayFrame = 0;
-static std::unordered_map<std::string, int> s_inputState;
 
-std::vector<ReplayEvent> ReplayPlayer::s_frameEvents;
-std::vector<ReplayEvent> ReplayPlayer::s_events;
+std::vector<ReplayPlayer::Event> ReplayPlayer::s_events;
 size_t ReplayPlayer::s_cursor = 0;
+std::vector<int32_t> ReplayPlayer::s_state;
 
-// ===== API =====
-bool ReplayPlayer::Start(const char *filename)
+// ===== SMR1 読み込み =====
+
+static void ReadSMR1(FILE *fp, std::vector<std::string> &ids, std::vector<LoadedEvent> &events)
 {
+    // 同じ ID 文字列が全フレーム分並んでいるので、読みながら番号に置き換える
+    std::unordered_map<std::string, uint32_t> idIndex;
+    ReplayEvent ev;
+    while (fread(&ev, sizeof(ev), 1, fp) == 1)
+    {
+        ev.id[sizeof(ev.id) - 1] = '\0';
+        auto it = idIndex.find(ev.id);
+        if (it == idIndex.end())
+        {
+            it = idIndex.emplace(ev.id, uint32_t(ids.size())).first;
+            ids.emplace_back(ev.id);
+        }
+        events.push_back({ ev.frame, it->second, ev.value });
+    }
+}
+
+// ===== SMR2 読み込み =====
+
+// ヘッダ以降を全部読み込む（圧縮されていれば展開する）
+static bool ReadBody(FILE *fp, bool compressed, std::vector<uint8_t> &out)
+{
+    std::vector<uint8_t> raw;
+    uint8_t chunk[64 * 1024];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+        raw.insert(raw.end(), chunk, chunk + n);
+
+    if (!compressed)
+    {
+        out.swap(raw);
+        return true;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK)
+        return false;
+    zs.next_in = raw.data();
+    zs.avail_in = uInt(raw.size());
+    int ret;
+    do
+    {
+        zs.next_out = chunk;
+        zs.avail_out = sizeof(chunk);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        out.insert(out.end(), chunk, chunk + (sizeof(chunk) - zs.avail_out));
+    } while (ret == Z_OK);
+    inflateEnd(&zs);
+
+    // 途中で切れたファイル（録画中のクラッシュ等）は読めた所まで使う
+    if (ret != Z_STREAM_END)
+        printf("[Replay] Compressed replay is truncated\n");
+    return true;
+}
+
+static bool SeekTo(FILE *fp, int64_t offset, int origin = SEEK_SET)
+{
+#ifdef _WIN32
+    return _fseeki64(fp, offset, origin) == 0;
+#else
+    return fseeko(fp, off_t(offset), origin) == 0;
+#endif
+}
+
+static uint32_t GetU32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint64_t GetU64(const uint8_t *p)
+{
+    return uint64_t(GetU32(p)) | (uint64_t(GetU32(p + 4)) << 32);
+}
+
+// チャンク形式: EVENTS を連結し、KEYFRAME は位置だけ覚えて読み飛ばす
+static bool ReadChunks(FILE *fp, bool compressed, std::vector<uint8_t> &out, std::vector<KeyframeRef> &keyframes)
+{
+    uint64_t offset = sizeof(ReplayHeader);
+    std::vector<uint8_t> data;
+    uint8_t header[REPLAY_CHUNK_HEADER_SIZE];
+    while (fread(header, sizeof(header), 1, fp) == 1)
+    {
+        uint8_t type = header[0];
+        uint32_t size = GetU32(header + 1);
+
+        if (type == REPLAY_CHUNK_INDEX)
+            return true;
+
+        if (type == REPLAY_CHUNK_KEYFRAME)
+        {
+            uint8_t frame[4];
+            if (size < 8 || fread(frame, sizeof(frame), 1, fp) != 1)
+                return false;
+            keyframes.push_back({ GetU32(frame), offset });
+            offset += REPLAY_CHUNK_HEADER_SIZE + size;
+            if (!SeekTo(fp, int64_t(offset)))
+                return false;
+            continue;
+        }
+
+        data.resize(size);
+        if (size && fread(data.data(), size, 1, fp) != 1)
+            return false;
+        offset += REPLAY_CHUNK_HEADER_SIZE + size;
+        if (type != REPLAY_CHUNK_EVENTS)
+            continue; // 知らないチャンクは無視
+
+        if (!compressed)
+        {
+            out.insert(out.end(), data.begin(), data.end());
+            continue;
+        }
+
+        if (size < 4)
+            return false;
+        uint32_t rawSize = GetU32(data.data());
+        if (size - 4 == rawSize)
+        {
+            out.insert(out.end(), data.begin() + 4, data.end());
+            continue;
+        }
+        size_t pos = out.size();
+        out.resize(pos + rawSize);
+        uLongf len = rawSize;
+        if (uncompress(out.data() + pos, &len, data.data() + 4, size - 4) != Z_OK || len != rawSize)
+        {
+            out.resize(pos);
+            return false;
+        }
+    }
+
+    // 末尾（INDEX）が無い: 録画中に落ちたファイル
+    printf("[Replay] Replay file has no index (recording was interrupted?)\n");
+    return true;
+}
+
+// SMR2 の変化グループをイベント列に展開する
+static bool DecodeSMR2(const std::vector<uint8_t> &body, std::vector<std::string> &ids, std::vector<LoadedEvent> &events)
+{
+    const uint8_t *p = body.data();
+    const uint8_t *end = p + body.size();
+    uint32_t frame = 0;
+
+    while (p < end)
+    {
+        uint32_t frameDelta, count;
+        if (!ReplayGetVarint(p, end, frameDelta) || !ReplayGetVarint(p, end, count))
+            return false;
+        frame += frameDelta;
 
+        if (count == 0)
+        {
+            // 記録終了フレーム: 何もしないイベントで最後のフレームまで再生を続けさせる
+            events.push_back({ frame, NO_ID, 0 });
+            continue;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t index;
+            if (!ReplayGetVarint(p, end, index))
+                return false;
+            if (index == ids.size())
+            {
+                // 初出の入力名
+                if (p >= end || size_t(end - p) < size_t(1 + *p) || *p > REPLAY_MAX_ID_LEN)
+                    return false;
+                size_t len = *p++;
+                ids.emplace_back(reinterpret_cast<const char *>(p), len);
+                p += len;
+            }
+            else if (index > ids.size())
+                return false;
+
+            int32_t value;
+            if (!ReplayGetSVarint(p, end, value))
+                return false;
+            events.push_back({ frame, index, value });
+        }
+    }
+    return true;
+}
+
+// ===== API =====
+bool ReplayPlayer::Start(const char *filename, CInputs *inputs)
+{
     if (s_playing)
         return false;
 
@@ -48,8 +250,13 @@ bool ReplayPlayer::Start(const char *filename)
     }
 
     ReplayHeader h{};
-    if (fread(&h, sizeof(h), 1, s_fp) != 1 ||
-        memcmp(h.magic, "SMR1", 4) != 0)
+    bool smr1 = false, smr2 = false;
+    if (fread(&h, sizeof(h), 1, s_fp) == 1)
+    {
+        smr1 = memcmp(h.magic, "SMR1", 4) == 0;
+        smr2 = memcmp(h.magic, "SMR2", 4) == 0;
+    }
+    if (!smr1 && !smr2)
     {
         printf("[Replay] Invalid replay file\n");
         fclose(s_fp);
@@ -57,7 +264,7 @@ bool ReplayPlayer::Start(const char *filename)
         return false;
     }
 
-    if (h.version != 1)
+    if (h.version != (smr1 ? 1u : 2u))
     {
         printf("[Replay] Unsupported replay version: %u\n", h.version);
         fclose(s_fp);
@@ -65,25 +272,65 @@ bool ReplayPlayer::Start(const char *filename)
         return false;
     }
 
-    ReplayEvent ev;
-    while (fread(&ev, sizeof(ev), 1, s_fp) == 1)
+    std::vector<std::string> ids;
+    std::vector<LoadedEvent> loaded;
+    s_keyframes.clear();
+    if (smr1)
     {
-        s_events.push_back(ev);
+        ReadSMR1(s_fp, ids, loaded);
+    }
+    else
+    {
+        std::vector<uint8_t> body;
+        bool compressed = (h.flags & REPLAY_FLAG_ZLIB) != 0;
+        bool ok;
+        if (h.flags & REPLAY_FLAG_CHUNKED)
+            ok = ReadChunks(s_fp, compressed, body, s_keyframes);
+        else
+            ok = ReadBody(s_fp, compressed, body);
+        if (!DecodeSMR2(body, ids, loaded) || !ok)
+        {
+            // 壊れた箇所より前のイベントだけで再生する
+            printf("[Replay] Replay file is corrupt after %zu events\n", loaded.size());
+        }
     }
 
-    printf("[Replay] Loaded %zu events\n", s_events.size());
-
-    if (!s_events.empty())
+    // ID 表を入力のスロット番号に解決する（文字列比較はここだけ）
+    unsigned numInputs = inputs ? inputs->Count() : 0;
+    std::vector<int32_t> slotOf(ids.size(), -1);
+    for (size_t i = 0; i < ids.size(); i++)
     {
-        s_replayFrame = s_events[0].frame;
+        for (unsigned slot = 0; slot < numInputs; slot++)
+        {
+            if (ids[i] == (*inputs)[slot]->id)
+            {
+                slotOf[i] = int32_t(slot);
+                break;
+            }
+        }
+        if (slotOf[i] < 0)
+            printf("[Replay] Ignoring unknown input: %s\n", ids[i].c_str());
     }
-    else
+
+    s_events.clear();
+    s_events.reserve(loaded.size());
+    for (const LoadedEvent &ev : loaded)
     {
-        s_inputState.clear();
-        s_replayFrame = 0;
-        s_cursor = 0;
+        int32_t slot = ev.id < slotOf.size() ? slotOf[ev.id] : -1;
+        s_events.push_back({ ev.frame, slot, ev.value });
     }
+    s_state.assign(numInputs, 0);
+    s_cursor = 0;
+
+    s_lastFrame = s_events.empty() ? 0 : s_events.back().frame;
+
+    // 壊れた箇所より後ろのキーフレームには入力が揃っていないので使わない
+    while (!s_keyframes.empty() && s_keyframes.back().frame > s_lastFrame)
+        s_keyframes.pop_back();
 
+    printf("[Replay] Loaded %zu events, %zu keyframes\n", s_events.size(), s_keyframes.size());
+
+    g_frameCounter = 0;
     s_playing = true;
 
     printf("[Replay] Playback started\n");
@@ -107,74 +354,119 @@ void ReplayPlayer::Stop()
     printf("[Replay] Playback stopped\n");
 }
 
-void ReplayPlayer::Tick()
+uint32_t ReplayPlayer::GetFrame()
 {
-    if (!s_playing)
-        return;
+    return g_frameCounter;
+}
 
-    ++s_replayFrame;
+uint32_t ReplayPlayer::GetLastFrame()
+{
+    return s_lastFrame;
 }
-uint32_t ReplayPlayer::GetFrame()
+
+bool ReplayPlayer::FindKeyframe(uint32_t frame, uint32_t &keyframeFrame)
 {
-    return s_replayFrame;
+    // frame 以前で一番近いもの（キーフレームはフレーム順に並んでいる）
+    auto it = std::upper_bound(s_keyframes.begin(), s_keyframes.end(), frame,
+                               [](uint32_t f, const KeyframeRef &k) { return f < k.frame; });
+    if (it == s_keyframes.begin())
+        return false;
+    keyframeFrame = (--it)->frame;
+    return true;
 }
-void ReplayPlayer::ProcessEvents(uint32_t emuFrame, std::vector<ReplayEvent> &outEvents)
+
+bool ReplayPlayer::LoadKeyframe(uint32_t keyframeFrame, std::vector<uint8_t> &state)
 {
-    // ★ まず最初に「もう終わっているか」をチェック
-    if (s_cursor >= s_events.size())
+    if (!s_playing)
+        return false;
+
+    const KeyframeRef *ref = nullptr;
+    for (const KeyframeRef &k : s_keyframes)
     {
-        Stop(); // ← 再生終了
-        return;
+        if (k.frame == keyframeFrame)
+        {
+            ref = &k;
+            break;
+        }
     }
-    // 差分イベントを state に反映
-    while (s_cursor < s_events.size() &&
-           s_events[s_cursor].frame == emuFrame)
+    if (!ref)
+        return false;
+
+    uint8_t header[REPLAY_CHUNK_HEADER_SIZE + 8];
+    if (!SeekTo(s_fp, int64_t(ref->offset)) || fread(header, sizeof(header), 1, s_fp) != 1 || header[0] != REPLAY_CHUNK_KEYFRAME)
     {
-        const ReplayEvent &ev = s_events[s_cursor];
-        s_inputState[ev.id] = ev.value;
-        s_cursor++;
+        printf("[Replay] Failed to read keyframe at frame %u\n", keyframeFrame);
+        return false;
     }
+    uint32_t packedSize = GetU32(header + 1) - 8;
+    uint32_t rawSize = GetU32(header + REPLAY_CHUNK_HEADER_SIZE + 4);
 
-    // ★ 差分反映後に「ここで尽きた」場合も止める
-    if (s_cursor >= s_events.size())
+    std::vector<uint8_t> packed(packedSize);
+    state.resize(rawSize);
+    uLongf len = rawSize;
+    if (fread(packed.data(), packedSize, 1, s_fp) != 1 ||
+        uncompress(state.data(), &len, packed.data(), packedSize) != Z_OK || len != rawSize)
     {
-        Stop();
-        return;
+        printf("[Replay] Keyframe at frame %u is corrupt\n", keyframeFrame);
+        return false;
     }
+    return true;
+}
 
-    // 現在の「全状態」を outEvents に詰める
-    outEvents.clear();
-    for (const auto &it : s_inputState)
-    {
-        ReplayEvent ev{};
-        ev.frame = emuFrame;
-        strncpy(ev.id, it.first.c_str(), sizeof(ev.id) - 1);
-        ev.id[sizeof(ev.id) - 1] = '\0';
-        ev.value = it.second;
+void ReplayPlayer::Seek(uint32_t keyframeFrame)
+{
+    if (!s_playing)
+        return;
 
-        outEvents.push_back(ev);
+    // キーフレームのフレームまでのイベントを反映した入力状態から再開する
+    std::fill(s_state.begin(), s_state.end(), 0);
+    s_cursor = 0;
+    while (s_cursor < s_events.size() && s_events[s_cursor].frame <= keyframeFrame)
+    {
+        const Event &ev = s_events[s_cursor];
+        if (ev.slot >= 0)
+            s_state[ev.slot] = ev.value;
+        s_cursor++;
     }
+    g_frameCounter = keyframeFrame + 1;
+
+    if (s_cursor >= s_events.size())
+        Stop();
 }
 
-// 特定の入力 ID の現在の値を返す
-int ReplayPlayer::GetInputValue(const char *id)
+bool ReplayPlayer::ReadInfo(const char *filename, uint32_t &lastFrame, unsigned &numKeyframes)
 {
-    auto it = s_inputState.find(id);
-    if (it != s_inputState.end())
+    // 末尾の INDEX だけ読む（イベントは展開しない）
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return false;
+
+    bool ok = false;
+    ReplayHeader h{};
+    uint8_t trailer[REPLAY_TRAILER_SIZE];
+    uint8_t index[REPLAY_CHUNK_HEADER_SIZE + 8];
+    if (fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, "SMR2", 4) == 0 && (h.flags & REPLAY_FLAG_CHUNKED) &&
+        SeekTo(fp, -int64_t(REPLAY_TRAILER_SIZE), SEEK_END) && fread(trailer, sizeof(trailer), 1, fp) == 1 &&
+        memcmp(trailer + 8, "SMRI", 4) == 0 &&
+        SeekTo(fp, int64_t(GetU64(trailer))) && fread(index, sizeof(index), 1, fp) == 1 && index[0] == REPLAY_CHUNK_INDEX)
     {
-        return it->second;
+        lastFrame = GetU32(index + REPLAY_CHUNK_HEADER_SIZE);
+        numKeyframes = GetU32(index + REPLAY_CHUNK_HEADER_SIZE + 4);
+        ok = true;
     }
-    return 0; // 記録がなければ 0
+    fclose(fp);
+    return ok;
 }
 
 void ReplayPlayer::UpdateState(uint32_t emuFrame)
 {
-    // cursor が末尾に達するまで、そのフレームのイベントをすべて map に流し込む
+    // cursor が末尾に達するまで、そのフレームのイベントをすべて state に流し込む
     // emuFrame が 100 なら、100番のイベントを全部拾う
     while (s_cursor < s_events.size() && s_events[s_cursor].frame == emuFrame)
     {
-        const ReplayEvent &ev = s_events[s_cursor];
-        s_inputState[ev.id] = ev.value;
+        const Event &ev = s_events[s_cursor];
+        if (ev.slot >= 0)
+            s_state[ev.slot] = ev.value;
         s_cursor++;
     }
 
@@ -3,33 +3,51 @@
 #include <cstdint>
 #include <cstdio>
 #include <vector>
-#include <unordered_map>
 
-class CInput;
-
-struct ReplayEvent;
+class CInputs;
 
 class ReplayPlayer
 {
 public:
-    static bool Start(const char *filename);
+    // 再生開始。記録された入力 ID はここで inputs のスロット番号に解決する
+    static bool Start(const char *filename, CInputs *inputs);
     static bool IsPlaying();
     static void Stop();
-    // static void ProcessEvents();
-    static void ProcessEvents(uint32_t emuFrame, std::vector<ReplayEvent> &outEvents);
-    static void Reset();
-    static void Tick();         // ★ 再生フレームを進める
-    static uint32_t GetFrame(); // ★ replayFrame を返す
+    static uint32_t GetFrame();     // 次に入力を反映するフレーム
+    static uint32_t GetLastFrame(); // 記録の最終フレーム
     static void UpdateState(uint32_t emuFrame);
-    static int GetInputValue(const char *id);
+
+    // ===== キーフレームでのシーク =====
+    // frame 以前で一番近いキーフレームを探す（無ければ false）
+    static bool FindKeyframe(uint32_t frame, uint32_t &keyframeFrame);
+    // キーフレームのセーブステートを展開して返す
+    static bool LoadKeyframe(uint32_t keyframeFrame, std::vector<uint8_t> &state);
+    // セーブステートを読み込んだ後に呼ぶ。入力状態とフレームをキーフレーム直後に合わせる
+    static void Seek(uint32_t keyframeFrame);
+
+    // 再生せずに長さとキーフレーム数だけ読む（GUI 用。索引の無いファイルは false）
+    static bool ReadInfo(const char *filename, uint32_t &lastFrame, unsigned &numKeyframes);
+
+    // スロット番号（CInputs 内の入力の並び）の現在値
+    static int GetInputValue(unsigned slot)
+    {
+        return slot < s_state.size() ? s_state[slot] : 0;
+    }
 
 private:
+    // 解決済みイベント（slot < 0 は該当入力なし / 記録終了フレーム）
+    struct Event
+    {
+        uint32_t frame;
+        int32_t slot;
+        int32_t value;
+    };
+
     static FILE *s_fp;
     static bool s_playing;
-    static uint32_t s_replayFrame;
-    static std::vector<ReplayEvent> s_events; // ★ 宣言
-    static size_t s_cursor;                   // ★ 宣言
+    static std::vector<Event> s_events;
+    static size_t s_cursor;
 
-    // ★ 1フレームのイベントをすべて保持する
-    static std::vector<ReplayEvent> s_frameEvents;
+    // ★ 全入力の現在値（スロット番号で引く）
+    static std::vector<int32_t> s_state;
 };
@@ -1,33 +1,269 @@
 #include "ReplayRecorder.h"
+#include "ReplayFormat.h"
 #include "Inputs/Input.h"
 
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <zlib.h>
 
-// ===== フォーマット定義 =====
-struct ReplayHeader
+// ===== 内部状態 =====
+static FILE *g_fp = nullptr;
+static bool g_recording = false;
+
+// 入力ごとの記録状態
+struct ReplaySlot
 {
-    char magic[4];     // "SMR1"
-    uint32_t version;  // 1
-    uint32_t flags;    // 0
-    uint32_t reserved; // 0
+    const char *id;     // CInput::id（静的文字列なのでポインタで識別できる）
+    int32_t value;      // 最後に記録した値
+    int32_t fileIndex;  // ファイル内の番号（未定義なら -1）
 };
 
-#pragma pack(push, 1)
-struct ReplayEvent
+static std::vector<ReplaySlot> g_slots;
+static std::unordered_map<const char *, size_t> g_slotByID;
+static std::vector<size_t> g_callOrder; // 前フレームの Capture 呼び出し順 → slot
+static size_t g_callPos = 0;
+static int32_t g_numDefined = 0;
+
+// 現在フレームの変化分
+static std::vector<uint8_t> g_changes;
+static uint32_t g_numChanges = 0;
+static uint32_t g_curFrame = 0;
+static uint32_t g_lastWrittenFrame = 0;
+
+// まだ書き込みスレッドに渡していない変化グループ
+static std::vector<uint8_t> g_events;
+static const size_t EVENT_CHUNK_SIZE = 64 * 1024;
+static const uint32_t FLUSH_INTERVAL = 120;  // 最低でもこのフレーム数ごとにディスクまで書く（約2秒）
+static uint32_t g_lastHandOffFrame = 0;
+
+static uint32_t g_keyframeInterval = 0;  // フレーム数（0 = 無効）
+static uint32_t g_lastKeyframeFrame = 0;
+
+// ===== 書き込みスレッド =====
+//
+// エミュレーションスレッドはロックせずに g_events へ追記するだけで、圧縮と
+// ファイル書き込みはすべて書き込みスレッドが行う。受け渡しはバッファごと
+// （フレームの区切りで、数秒に一度程度）で、書き終えたバッファは再利用する。
+// g_fp と以下の g_keyframes, g_zbuf, g_fileOffset は、録画中は書き込みスレッドだけが触る。
+struct WriteJob
+{
+    ReplayChunkType type;
+    uint32_t frame;  // KEYFRAME のみ
+    std::vector<uint8_t> data;
+};
+
+static std::thread g_writer;
+static std::mutex g_writerMutex;
+static std::condition_variable g_writerCond;
+static std::vector<WriteJob> g_jobs;               // 書き込み待ち
+// 書き終えたバッファ。数 MB のキーフレームと 64KB 程度のイベントは別々に
+// 使い回す（混ぜるとキーフレーム用の大きなバッファがイベントに回ってしまう）
+static std::vector<std::vector<uint8_t>> g_spareEvents;
+static std::vector<std::vector<uint8_t>> g_spareKeyframes;
+static const size_t MAX_SPARE_EVENT_BUFFERS = 4;
+static const size_t MAX_SPARE_KEYFRAME_BUFFERS = 1;
+static bool g_writerExit = false;
+
+struct KeyframeEntry
 {
     uint32_t frame;
-    char id[32];
-    int32_t value;
+    uint64_t offset;
 };
-#pragma pack(pop)
+static std::vector<KeyframeEntry> g_keyframes;
 
-// ===== 内部状態 =====
-static FILE *g_fp = nullptr;
-static bool g_recording = false;
+static bool g_compress = false;
+static std::vector<uint8_t> g_zbuf;
+static uint64_t g_fileOffset = 0;        // 書き込んだバイト数 = 次のチャンクの位置
+
+static void PutU32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back(uint8_t(v >> (i * 8)));
+}
+
+static void PutU64(std::vector<uint8_t> &out, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        out.push_back(uint8_t(v >> (i * 8)));
+}
+
+static void WriteBytes(const void *data, size_t size)
+{
+    fwrite(data, 1, size, g_fp);
+    g_fileOffset += size;
+}
+
+static void WriteChunk(ReplayChunkType type, const std::vector<uint8_t> &prefix, const uint8_t *data, size_t size)
+{
+    std::vector<uint8_t> header;
+    header.push_back(type);
+    PutU32(header, uint32_t(prefix.size() + size));
+    WriteBytes(header.data(), header.size());
+    if (!prefix.empty())
+        WriteBytes(prefix.data(), prefix.size());
+    if (size)
+        WriteBytes(data, size);
+}
+
+// zlib で g_zbuf に圧縮する（失敗したら false）
+static bool Compress(const uint8_t *data, size_t size, size_t &packedSize)
+{
+    uLongf len = compressBound(uLong(size));
+    if (g_zbuf.size() < len)
+        g_zbuf.resize(len);
+    if (compress2(g_zbuf.data(), &len, data, uLong(size), Z_BEST_SPEED) != Z_OK)
+        return false;
+    packedSize = len;
+    return true;
+}
+
+// 変化グループを EVENTS チャンクとして書く（書き込みスレッド）
+static void WriteEvents(const std::vector<uint8_t> &events)
+{
+    if (!g_compress)
+    {
+        WriteChunk(REPLAY_CHUNK_EVENTS, {}, events.data(), events.size());
+        return;
+    }
+
+    // 縮まなかった場合はそのまま格納する（データ長 == rawSize で判別）
+    std::vector<uint8_t> prefix;
+    PutU32(prefix, uint32_t(events.size()));
+    size_t packedSize;
+    if (Compress(events.data(), events.size(), packedSize) && packedSize < events.size())
+        WriteChunk(REPLAY_CHUNK_EVENTS, prefix, g_zbuf.data(), packedSize);
+    else
+        WriteChunk(REPLAY_CHUNK_EVENTS, prefix, events.data(), events.size());
+}
+
+// セーブステートを KEYFRAME チャンクとして書く（書き込みスレッド）
+static void WriteKeyframe(uint32_t frame, const std::vector<uint8_t> &state)
+{
+    size_t packedSize;
+    if (!Compress(state.data(), state.size(), packedSize))
+    {
+        printf("[Replay] Failed to compress keyframe at frame %u\n", frame);
+        return;
+    }
+
+    g_keyframes.push_back({ frame, g_fileOffset });
+    std::vector<uint8_t> prefix;
+    PutU32(prefix, frame);
+    PutU32(prefix, uint32_t(state.size()));
+    WriteChunk(REPLAY_CHUNK_KEYFRAME, prefix, g_zbuf.data(), packedSize);
+}
+
+static void WriterThread()
+{
+    std::vector<WriteJob> jobs;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(g_writerMutex);
+            g_writerCond.wait(lock, [] { return !g_jobs.empty() || g_writerExit; });
+            if (g_jobs.empty())
+                return; // 終了要求で、書くものも残っていない
+            jobs.swap(g_jobs);
+        }
+
+        for (const WriteJob &job : jobs)
+        {
+            if (job.type == REPLAY_CHUNK_KEYFRAME)
+                WriteKeyframe(job.frame, job.data);
+            else
+                WriteEvents(job.data);
+        }
+
+        // 受け渡し毎にディスクへ出す（クラッシュしてもここまでは残る）
+        fflush(g_fp);
+
+        std::lock_guard<std::mutex> lock(g_writerMutex);
+        for (WriteJob &job : jobs)
+        {
+            bool keyframe = job.type == REPLAY_CHUNK_KEYFRAME;
+            std::vector<std::vector<uint8_t>> &spare = keyframe ? g_spareKeyframes : g_spareEvents;
+            if (spare.size() < (keyframe ? MAX_SPARE_KEYFRAME_BUFFERS : MAX_SPARE_EVENT_BUFFERS))
+            {
+                job.data.clear();
+                spare.push_back(std::move(job.data));
+            }
+        }
+        jobs.clear();
+    }
+}
+
+// バッファを書き込みスレッドに渡し、代わりに空きバッファを受け取る
+static void Submit(ReplayChunkType type, uint32_t frame, std::vector<uint8_t> &data)
+{
+    std::lock_guard<std::mutex> lock(g_writerMutex);
+    g_jobs.push_back({ type, frame, std::move(data) });
+    data.clear();
+    std::vector<std::vector<uint8_t>> &spare = type == REPLAY_CHUNK_KEYFRAME ? g_spareKeyframes : g_spareEvents;
+    if (!spare.empty())
+    {
+        data.swap(spare.back());
+        spare.pop_back();
+    }
+    g_writerCond.notify_one();
+}
+
+static void HandOffEvents()
+{
+    if (!g_events.empty())
+        Submit(REPLAY_CHUNK_EVENTS, 0, g_events);
+    g_lastHandOffFrame = g_curFrame;
+}
+
+// 溜まったフレームの変化をグループとして追記する
+static void FlushFrame(bool force)
+{
+    if (g_numChanges == 0 && !force)
+        return;
+
+    ReplayPutVarint(g_events, g_curFrame - g_lastWrittenFrame);
+    ReplayPutVarint(g_events, g_numChanges);
+    g_events.insert(g_events.end(), g_changes.begin(), g_changes.end());
+    if (g_events.size() >= EVENT_CHUNK_SIZE)
+        HandOffEvents();
+
+    g_lastWrittenFrame = g_curFrame;
+    g_changes.clear();
+    g_numChanges = 0;
+}
+
+static size_t FindSlot(const char *id)
+{
+    // 入力は毎フレーム同じ順番で来るので、前回の順番をまず試す
+    if (g_callPos < g_callOrder.size() && g_slots[g_callOrder[g_callPos]].id == id)
+        return g_callOrder[g_callPos++];
+
+    size_t slot;
+    auto it = g_slotByID.find(id);
+    if (it != g_slotByID.end())
+        slot = it->second;
+    else
+    {
+        slot = g_slots.size();
+        g_slots.push_back({ id, 0, -1 });
+        g_slotByID[id] = slot;
+    }
+
+    if (g_callPos < g_callOrder.size())
+        g_callOrder[g_callPos] = slot;
+    else
+        g_callOrder.push_back(slot);
+    g_callPos++;
+    return slot;
+}
 
 // ===== API =====
-void ReplayRecorder::Start(const char *filename)
+void ReplayRecorder::Start(const char *filename, bool compress, unsigned keyframeInterval)
 {
     if (g_recording)
         return;
@@ -39,18 +275,40 @@ void ReplayRecorder::Start(const char *filename)
         return;
     }
 
-    // ヘッダ書き込み
+    // ヘッダ書き込み（ヘッダ自体は常に非圧縮）
     ReplayHeader h{};
-    memcpy(h.magic, "SMR1", 4);
-    h.version = 1;
-    h.flags = 0;
+    memcpy(h.magic, "SMR2", 4);
+    h.version = 2;
+    h.flags = REPLAY_FLAG_CHUNKED | (compress ? REPLAY_FLAG_ZLIB : 0);
     h.reserved = 0;
 
-    fwrite(&h, sizeof(h), 1, g_fp);
+    g_fileOffset = 0;
+    WriteBytes(&h, sizeof(h));
     fflush(g_fp);
 
+    g_compress = compress;
+    g_events.clear();
+    g_lastHandOffFrame = 0;
+    g_keyframes.clear();
+    g_keyframeInterval = keyframeInterval;
+    g_lastKeyframeFrame = 0;
+
+    g_slots.clear();
+    g_slotByID.clear();
+    g_callOrder.clear();
+    g_callPos = 0;
+    g_numDefined = 0;
+    g_changes.clear();
+    g_numChanges = 0;
+    g_curFrame = 0;
+    g_lastWrittenFrame = 0;
+
+    g_jobs.clear();
+    g_writerExit = false;
+    g_writer = std::thread(WriterThread);
+
     g_recording = true;
-    printf("[Replay] Recording started: %s\n", filename);
+    printf("[Replay] Recording started: %s%s\n", filename, compress ? " (compressed)" : "");
 }
 
 bool ReplayRecorder::IsRecording()
@@ -63,6 +321,36 @@ void ReplayRecorder::Stop()
     if (!g_recording)
         return;
 
+    // 最後のフレームを終端として必ず書く（再生側はここで止まる）
+    FlushFrame(true);
+    HandOffEvents();
+
+    // 書き込み待ちを全部書かせてからスレッドを終える
+    {
+        std::lock_guard<std::mutex> lock(g_writerMutex);
+        g_writerExit = true;
+        g_writerCond.notify_one();
+    }
+    g_writer.join();
+    g_spareEvents.clear();
+    g_spareKeyframes.clear();
+
+    // キーフレーム索引と、その位置を指す末尾
+    uint64_t indexOffset = g_fileOffset;
+    std::vector<uint8_t> index;
+    PutU32(index, g_curFrame);
+    PutU32(index, uint32_t(g_keyframes.size()));
+    for (const KeyframeEntry &k : g_keyframes)
+    {
+        PutU32(index, k.frame);
+        PutU64(index, k.offset);
+    }
+    WriteChunk(REPLAY_CHUNK_INDEX, index, nullptr, 0);
+    std::vector<uint8_t> trailer;
+    PutU64(trailer, indexOffset);
+    trailer.insert(trailer.end(), { 'S', 'M', 'R', 'I' });
+    WriteBytes(trailer.data(), trailer.size());
+
     fflush(g_fp);
     fclose(g_fp);
     g_fp = nullptr;
@@ -76,14 +364,54 @@ void ReplayRecorder::Capture(uint32_t frame, const char *id, int value)
     if (!g_recording || !g_fp)
         return;
 
-    ReplayEvent ev{};
-    ev.frame = frame + 1;
+    frame += 1;
+    if (frame != g_curFrame)
+    {
+        FlushFrame(false);
+        if (g_curFrame - g_lastHandOffFrame >= FLUSH_INTERVAL)
+            HandOffEvents();
+        g_curFrame = frame;
+        g_callPos = 0;
+    }
+
+    // 値が変わった入力だけ記録する
+    ReplaySlot &s = g_slots[FindSlot(id)];
+    if (s.value == value)
+        return;
+    s.value = value;
+
+    if (s.fileIndex < 0)
+    {
+        // 初出の入力: 番号を割り当てて名前を定義する
+        s.fileIndex = g_numDefined++;
+        ReplayPutVarint(g_changes, uint32_t(s.fileIndex));
+        size_t len = strlen(id);
+        if (len > REPLAY_MAX_ID_LEN)
+            len = REPLAY_MAX_ID_LEN;
+        g_changes.push_back(uint8_t(len));
+        g_changes.insert(g_changes.end(), id, id + len);
+    }
+    else
+        ReplayPutVarint(g_changes, uint32_t(s.fileIndex));
+    ReplayPutSVarint(g_changes, value);
+    g_numChanges++;
+}
+
+bool ReplayRecorder::KeyframeDue()
+{
+    return g_recording && g_keyframeInterval && g_curFrame - g_lastKeyframeFrame >= g_keyframeInterval;
+}
 
-    // 安全なコピー（32バイトのバッファなら、最大31文字 + 終端ヌル）
-    strncpy(ev.id, id, sizeof(ev.id) - 1);
-    ev.id[sizeof(ev.id) - 1] = '\0';
+void ReplayRecorder::AddKeyframe(std::vector<uint8_t> &state)
+{
+    if (!g_recording || !g_fp)
+        return;
 
-    ev.value = value;
+    // このフレームまでのイベントを先に渡しておく（キーフレームはその後の状態）
+    FlushFrame(false);
+    HandOffEvents();
 
-    fwrite(&ev, sizeof(ev), 1, g_fp);
-}
\ No newline at end of file
+    // 圧縮と書き込みは書き込みスレッドで。バッファごと渡すのでコピーもしない
+    Submit(REPLAY_CHUNK_KEYFRAME, g_curFrame, state);
+    g_lastKeyframeFrame = g_curFrame;
+}
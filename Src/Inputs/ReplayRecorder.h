@@ -2,14 +2,15 @@
 
 #include <cstdio>
 #include <cstdint>
+#include <vector>
 
 class CInput;
 
 class ReplayRecorder
 {
 public:
-    // 録画開始
-    static void Start(const char *filename);
+    // 録画開始（SMR2 形式。compress なら zlib 圧縮、keyframeInterval フレーム毎にキーフレーム）
+    static void Start(const char *filename, bool compress = false, unsigned keyframeInterval = 0);
 
     // 録画中か？
     static bool IsRecording();
@@ -17,5 +18,13 @@ public:
     // 終了処理（明示 or atexit 用）
     static void Stop();
 
+    // 入力値を記録する（前回から変化した値だけがファイルに書かれる）
     static void Capture(uint32_t frame, const char *mapping, int value);
+
+    // キーフレームを入れる時期か？（録画側が状態を保存して AddKeyframe() に渡す）
+    static bool KeyframeDue();
+
+    // 直前に Capture() したフレームの後の状態としてセーブステートを埋め込む
+    // （state の中身は書き込みスレッドに渡し、代わりに空きバッファが入る）
+    static void AddKeyframe(std::vector<uint8_t> &state);
 };
\ No newline at end of file
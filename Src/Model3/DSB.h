@@ -74,12 +74,12 @@ public:
 	int		UpSampleAndMix(float *outL, float *outR, INT16 *inL, INT16 *inR, UINT8 volumeL, UINT8 volumeR, int sizeOut, int sizeIn, int outRate, int inRate);
 	void	Reset(void);
 	CDSBResampler(const Util::Config::Node &config)
-	  : m_config(config)
+	  : m_musicVolume(config.Get("MusicVolume"), 100)
 	{
 		Reset();
 	}
 private:
-	const Util::Config::Node &m_config;
+	Util::Config::Observed<int>	m_musicVolume;
 	int	nFrac;
 	int	pFrac;
 };
@@ -203,6 +203,7 @@ public:
 
 private:
   const Util::Config::Node &m_config;
+	Util::Config::Observed<bool>	m_emulateDSB;
 
 	// Resampler
 	CDSBResampler	Resampler;
@@ -280,6 +281,7 @@ public:
 
 private:
 	const Util::Config::Node &m_config;
+	Util::Config::Observed<bool>	m_emulateDSB;
 
 	// Private helper functions
 	void	WriteMPEGFIFO(UINT8 byte);
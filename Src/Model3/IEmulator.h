@@ -28,9 +28,13 @@
 #ifndef INCLUDED_IEMULATOR_H
 #define INCLUDED_IEMULATOR_H
 
+#include <cstddef>
+#include <string>
+
 class CBlockFile;
 struct Game;
 struct ROMSet;
+struct ROMDestination;
 class CRender2D;
 class IRender3D;
 class CInputs;
@@ -69,6 +73,22 @@ public:
    *    SaveState   Block file to load state information from.
    */
   virtual void LoadState(CBlockFile *SaveState) = 0;
+
+  /*
+   * RestoreState(SaveState):
+   *
+   * Like LoadState, but for a state saved from the running machine a few
+   * frames earlier (e.g., by run-ahead). Emulators may update only what
+   * changed and skip refreshing the display, which will be out of date until
+   * the next frame is run. Same restrictions as LoadState.
+   *
+   * Parameters:
+   *    SaveState   Block file to load state information from.
+   */
+  virtual void RestoreState(CBlockFile *SaveState)
+  {
+    LoadState(SaveState);
+  }
   
   /*
    * SaveNVRAM(NVRAM):
@@ -141,6 +161,22 @@ public:
    *    OKAY if successful, FAIL otherwise. Prints errors.
    */
   virtual Result LoadGame(const Game &game, const ROMSet &rom_set) = 0;
+
+  /*
+   * GetROMDestination(region_name, region_size):
+   *
+   * Returns where in emulator memory a ROM region may be loaded directly, so
+   * that LoadGame() need not copy it. Only valid after Init().
+   *
+   * Parameters:
+   *    region_name   ROM region name from the game XML.
+   *    region_size   Size of the region in bytes.
+   *
+   * Returns:
+   *    Destination, or one with a null pointer if the region is to be loaded
+   *    into a separate buffer.
+   */
+  virtual ROMDestination GetROMDestination(const std::string &region_name, size_t region_size) = 0;
   
   /*
    * AttachRenderers(Render2DPtr, Render3DPtr):
@@ -232,8 +232,10 @@
 #endif // NET_BOARD
 #include "OSD/Audio.h"
 #include "OSD/Video.h"
+#include "OSD/VirtualMemory.h"
 #include "Util/Format.h"
 #include "Util/ByteSwap.h"
+#include <zlib.h>
 #include <functional>
 #include <set>
 #include <iostream>
@@ -864,7 +866,7 @@ void CModel3::WritePCIConfigSpace(unsigned device, unsigned reg, unsigned bits,
 void CModel3::SetCROMBank(unsigned idx)
 {
   cromBankReg = idx;
-  idx = (~idx) & 0xF;
+  idx = (~idx) & cromBankMask;
   cromBank = &crom[0x800000 + (idx*0x800000)];
   DebugLog("CROM bank setting: %d (%02X), PC=%08X, LR=%08X\n", idx, cromBankReg, ppc_get_pc(), ppc_get_lr());
 }
@@ -1904,6 +1906,16 @@ void CModel3::SaveState(CBlockFile *SaveState)
 }
 
 void CModel3::LoadState(CBlockFile *SaveState)
+{
+  LoadState(SaveState, false);
+}
+
+void CModel3::RestoreState(CBlockFile *SaveState)
+{
+  LoadState(SaveState, true);
+}
+
+void CModel3::LoadState(CBlockFile *SaveState, bool restore)
 {
   // Load Model 3 state
   if (Result::OKAY != SaveState->FindBlock("Model 3"))
@@ -1929,8 +1941,17 @@ void CModel3::LoadState(CBlockFile *SaveState)
   m_securityFirstRead = securityFirstRead != 0;
 
   // All devices...
-  GPU.LoadState(SaveState);
-  TileGen.LoadState(SaveState);
+  if (restore)
+  {
+    // Only update what changed, leaving the display as it is
+    GPU.RestoreState(SaveState);
+    TileGen.RestoreState(SaveState);
+  }
+  else
+  {
+    GPU.LoadState(SaveState);
+    TileGen.LoadState(SaveState);
+  }
   EEPROM.LoadState(SaveState);
   SCSI.LoadState(SaveState);
   PCIBridge.LoadState(SaveState);
@@ -2078,6 +2099,9 @@ void CModel3::RunMainBoardFrame(void)
 {
 	UINT32 start = CThread::GetTicks();
 
+	// Bring Real3D memory up to date after the last snapshot swap, while the renderer draws from the snapshot
+	GPU.SyncLiveMemory();
+
 	/* 
    * Compute display timings. Refresh rate is 57.524160 Hz and we assume frame timing is the same as System 24:
    *
@@ -2184,6 +2208,9 @@ void CModel3::SyncGPUs(void)
   UINT32 start = CThread::GetTicks();
 
   timings.syncSize = GPU.SyncSnapshots() + TileGen.SyncSnapshots();
+  timings.real3DSync = GPU.GetSnapshotStats();
+  timings.real3DUpdates = GPU.GetUpdateBlockStats();
+  timings.real3DTextures = GPU.GetTextureUploadStats();
   gpusReady = true;
 
   timings.syncTicks = CThread::GetTicks() - start;
@@ -2498,6 +2525,14 @@ void CModel3::DumpTimings(void)
     timings.sndTicks, (timings.sndTicks > 10 ? '!' : ','),
     timings.drvTicks, (timings.drvTicks > 10 ? '!' : ','),
     timings.frameTicks, (timings.frameTicks > 16 ? '!' : ' '));
+  const SnapshotStats &sync = timings.real3DSync;
+  printf("  sync cullLo:%4uK/%5uus cullHi:%4uK/%5uus poly:%4uK/%5uus texture:%4uK/%5uus updates:%4u/%4uK textures:%4u->%4u\n",
+    sync.bytes[SnapshotStats::CullingRAMLo] / 1024, sync.micros[SnapshotStats::CullingRAMLo],
+    sync.bytes[SnapshotStats::CullingRAMHi] / 1024, sync.micros[SnapshotStats::CullingRAMHi],
+    sync.bytes[SnapshotStats::PolyRAM] / 1024, sync.micros[SnapshotStats::PolyRAM],
+    sync.bytes[SnapshotStats::TextureRAM] / 1024, sync.micros[SnapshotStats::TextureRAM],
+    timings.real3DUpdates.blocks, timings.real3DUpdates.bytes / 1024,
+    timings.real3DTextures.queued, timings.real3DTextures.uploaded);
 }
 
 FrameTimings CModel3::GetTimings(void)
@@ -2505,6 +2540,15 @@ FrameTimings CModel3::GetTimings(void)
   return timings;
 }
 
+StateHashes CModel3::HashState(void) const
+{
+  StateHashes hashes;
+  hashes.ram = UINT32(crc32(0, ram, 0x800000));
+  hashes.real3D = GPU.HashMemory();
+  hashes.soundRAM = SoundBoard.HashMemory();
+  return hashes;
+}
+
 int CModel3::StartMainBoardThread(void *data)
 {
   // Call method on CModel3 to run PPC main board thread
@@ -2833,7 +2877,7 @@ ThreadError:
 void CModel3::Reset(void)
 {
   // Clear memory (but do not modify backup RAM!)
-  memset(ram, 0, 0x800000);
+  VirtualMemory::Discard(ram, 0x800000);
 
   // Initial bank is bank 0
   SetCROMBank(0xFF);
@@ -2874,6 +2918,9 @@ void CModel3::Reset(void)
   timings.ppcTicks = 0;
   timings.syncSize = 0;
   timings.syncTicks = 0;
+  timings.real3DSync = SnapshotStats();
+  timings.real3DUpdates = UpdateBlockStats();
+  timings.real3DTextures = TextureUploadStats();
   timings.renderTicks = 0;
   timings.sndTicks = 0;
   timings.drvTicks = 0;
@@ -2897,6 +2944,71 @@ const Game &CModel3::GetGame() const
   return m_game;
 }
 
+/*
+ * Mirrors a ROM that GameLoader placed in the memory pool. If the ROM is
+ * mapped from the ROM cache, the whole pages of the mirror are mapped from the
+ * same file range so that they, too, are only read in when touched.
+ */
+static void MirrorROM(const ROM &rom, uint8_t *dest, size_t dest_size)
+{
+  size_t size = std::min(rom.size, dest_size);
+  size_t mapped = 0;
+  if (!rom.mapped_file.empty())
+  {
+    mapped = size & ~(VirtualMemory::GetPageSize() - 1);
+    if (mapped && !VirtualMemory::MapFile(dest, mapped, rom.mapped_file, rom.mapped_offset))
+      mapped = 0;
+  }
+  memcpy(dest + mapped, rom.data.get() + mapped, size - mapped);
+}
+
+/*
+ * Copies a ROM (or a mirror of it) into the memory pool and converts it to
+ * little endian words of word_size bytes. ROMs that GameLoader placed in the
+ * memory pool itself are already patched and converted, so they are skipped
+ * and their mirrors are plain copies.
+ */
+static void CopyROM(const ROM &rom, uint8_t *dest, size_t dest_size, unsigned word_size)
+{
+  if (rom.in_place)
+  {
+    if (rom.data.get() != dest)
+      MirrorROM(rom, dest, dest_size);
+    return;
+  }
+  rom.CopyTo(dest, dest_size);
+  size_t size = std::min(rom.size, dest_size) & ~size_t(word_size - 1);
+  if (word_size == 4)
+    Util::FlipEndian32(dest, size);
+  else if (word_size == 2)
+    Util::FlipEndian16(dest, size);
+}
+
+ROMDestination CModel3::GetROMDestination(const std::string &region_name, size_t region_size)
+{
+  // See LoadGame() for the memory layout
+  ROMDestination dest;
+  if (NULL == memoryPool)
+    return dest;
+  if (region_name == "vrom")
+    dest = { vrom, 64*0x100000, 1 };
+  else if (region_name == "banked_crom")
+    dest = { &crom[8*0x100000], 128*0x100000, 4 };
+  else if (region_name == "crom" && region_size <= 8*0x100000)
+    dest = { &crom[8*0x100000 - region_size], region_size, 4 };
+  else if (region_name == "sound_samples")
+    dest = { sampleROM, 16*0x100000, 2 };
+  else if (region_name == "sound_program")
+    dest = { soundROM, 512*1024, 2 };
+  else if (region_name == "mpeg_program")
+    dest = { dsbROM, 128*1024, 1 };  // swapped in LoadGame() for DSB2 only
+  else if (region_name == "mpeg_music")
+    dest = { mpegROM, 16*0x100000, 1 };
+  else if (region_name == "driveboard_program")
+    dest = { driveROM, 64*1024, 1 };
+  return dest;
+}
+
 // Stepping-dependent parameters (MPC10x type, etc.) are initialized here
 Result CModel3::LoadGame(const Game &game, const ROMSet &rom_set)
 {
@@ -2906,45 +3018,48 @@ Result CModel3::LoadGame(const Game &game, const ROMSet &rom_set)
    * Copy in ROM data with mirroring as necessary for the following cases:
    *
    *  - VROM: 64MB. If <= 32MB, mirror to high 32MB.
-   *  - Banked CROM: 128MB. If <= 64MB, mirror to high 64MB.
+   *  - Banked CROM: 128MB. If <= 64MB, the high 64MB is mirrored by masking
+   *    the bank index in SetCROMBank() rather than by copying.
    *  - Fixed CROM: 8MB. If < 8MB, loaded only in high part of space and low
    *    part is a mirror of (banked) CROM0.
-   *  - Sample ROM: 16MB. If <= 8MB, mirror to high 8MB.
+   *  - Sample ROM: 16MB. If <= 8MB, the sound board maps its high bank onto
+   *    the low 8MB.
+   *
+   * Regions that are not copied into (upper mirrors, boards the game does not
+   * have) are never touched, so the memory pool does not commit them.
+   *
+   * PowerPC and 68K ROMs are converted to little endian words.
    */
   if (rom_set.get_rom("vrom").size <= 32*0x100000)
   {
-    rom_set.get_rom("vrom").CopyTo(&vrom[0], 32*100000);
-    rom_set.get_rom("vrom").CopyTo(&vrom[32*0x100000], 32*0x100000);
+    CopyROM(rom_set.get_rom("vrom"), &vrom[0], 32*0x100000, 1);
+    CopyROM(rom_set.get_rom("vrom"), &vrom[32*0x100000], 32*0x100000, 1);
   }
   else
-    rom_set.get_rom("vrom").CopyTo(vrom, 64*0x100000);
+    CopyROM(rom_set.get_rom("vrom"), vrom, 64*0x100000, 1);
   if (rom_set.get_rom("banked_crom").size <= 64*0x100000)
   {
-    rom_set.get_rom("banked_crom").CopyTo(&crom[8*0x100000 + 0], 64*0x100000);
-    rom_set.get_rom("banked_crom").CopyTo(&crom[8*0x100000 + 64*0x100000], 64*0x100000);
+    CopyROM(rom_set.get_rom("banked_crom"), &crom[8*0x100000 + 0], 64*0x100000, 4);
+    cromBankMask = 0x7;
   }
   else
-    rom_set.get_rom("banked_crom").CopyTo(&crom[8*0x100000 + 0], 128*0x100000);
+  {
+    CopyROM(rom_set.get_rom("banked_crom"), &crom[8*0x100000 + 0], 128*0x100000, 4);
+    cromBankMask = 0xF;
+  }
   size_t crom_size = rom_set.get_rom("crom").size;
-  rom_set.get_rom("crom").CopyTo(&crom[8*0x100000 - crom_size], crom_size);
+  CopyROM(rom_set.get_rom("crom"), &crom[8*0x100000 - crom_size], crom_size, 4);
   if (crom_size < 8*0x100000)
-    rom_set.get_rom("banked_crom").CopyTo(&crom[0], 8*0x100000 - crom_size);
+    CopyROM(rom_set.get_rom("banked_crom"), &crom[0], 8*0x100000 - crom_size, 4);
   if (rom_set.get_rom("sound_samples").size <= 8*0x100000)
-  {
-    rom_set.get_rom("sound_samples").CopyTo(&sampleROM[0], 8*0x100000);
-    rom_set.get_rom("sound_samples").CopyTo(&sampleROM[8*0x100000], 8*0x100000);
-  }
+    CopyROM(rom_set.get_rom("sound_samples"), &sampleROM[0], 8*0x100000, 2);
   else
-    rom_set.get_rom("sound_samples").CopyTo(sampleROM, 16*0x100000);
-  rom_set.get_rom("sound_program").CopyTo(soundROM, 512*1024);
-  rom_set.get_rom("mpeg_program").CopyTo(dsbROM, 128*1024);
-  rom_set.get_rom("mpeg_music").CopyTo(mpegROM, 16*0x100000);
-  rom_set.get_rom("driveboard_program").CopyTo(driveROM, 64*1024);
-
-  // Convert PowerPC and 68K ROMs to little endian words
-  Util::FlipEndian32(crom, 8*0x100000 + 128*0x100000);
-  Util::FlipEndian16(soundROM, 512*1024);
-  Util::FlipEndian16(sampleROM, 16*0x100000);
+    CopyROM(rom_set.get_rom("sound_samples"), sampleROM, 16*0x100000, 2);
+  SoundBoard.SetSampleROMSize(rom_set.get_rom("sound_samples").size);
+  CopyROM(rom_set.get_rom("sound_program"), soundROM, 512*1024, 2);
+  CopyROM(rom_set.get_rom("mpeg_program"), dsbROM, 128*1024, 1);
+  CopyROM(rom_set.get_rom("mpeg_music"), mpegROM, 16*0x100000, 1);
+  CopyROM(rom_set.get_rom("driveboard_program"), driveROM, 64*1024, 1);
 
   // Configure CPU and PCI bridge
   PPC_CONFIG  ppc_config;
@@ -3176,11 +3291,16 @@ Result CModel3::Init(void)
 {
   constexpr float memSizeMB = (float)MEM_POOL_SIZE / (float)0x100000;
 
-  // Allocate all memory for ROMs and PPC RAM
-  memoryPool = new(std::nothrow) UINT8[MEM_POOL_SIZE];
+  // Allocate all memory for ROMs and PPC RAM. Page-aligned and zero-filled,
+  // so that cached ROM images can be mapped straight into it. Transparent huge
+  // pages, where available, cut down on TLB misses from random CROM/VROM
+  // accesses. Explicit huge pages are not used: they would pin the unused
+  // regions and rule out mapping the ROM cache.
+  VirtualMemory::PageType pageType;
+  memoryPool = (UINT8 *) VirtualMemory::Allocate(MEM_POOL_SIZE, &pageType);
   if (NULL == memoryPool)
     return ErrorLog("Insufficient memory for Model 3 object (needs %1.1f MB).", memSizeMB);
-  memset(memoryPool, 0, MEM_POOL_SIZE);
+  InfoLog("Model 3 memory: %1.1f MB in %s.", memSizeMB, VirtualMemory::GetPageTypeName(pageType));
 
   // Set up pointers
   ram = &memoryPool[RAM_OFFSET];
@@ -3203,7 +3323,7 @@ Result CModel3::Init(void)
   PCIBridge.Init();
   PCIBus.Init();
   SCSI.Init(this,&IRQ,0x100); // SCSI is actually a non-maskable interrupt, so we give it a bit number outside of 8-bit range
-  RTC.Init();
+  RTC.Init(m_config["FixedRTC"].ValueAsDefault<bool>(false));
   EEPROM.Init();
   if (Result::OKAY != TileGen.Init(&IRQ))
     return Result::FAIL;
@@ -3319,6 +3439,7 @@ CModel3::CModel3(Util::Config::Node &config)
   driveROM = nullptr;
   OutputRegister[0] = OutputRegister[1] = 0;
   cromBankReg = 0;
+  cromBankMask = 0xF;
   memset(PPCFetchRegions, 0, sizeof(PPCFetchRegions));
   gpusReady = false;
   sndBrdNotifyLock = nullptr;
@@ -3365,7 +3486,7 @@ CModel3::~CModel3(void)
   // Free memory
   if (memoryPool != NULL)
   {
-    delete [] memoryPool;
+    VirtualMemory::Free(memoryPool, MEM_POOL_SIZE);
     memoryPool = NULL;
   }
 
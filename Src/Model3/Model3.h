@@ -58,6 +58,9 @@ struct FrameTimings
   UINT32 ppcTicks;
   UINT32 syncSize;
   UINT32 syncTicks;
+  SnapshotStats real3DSync; // Real3D pages copied back on the PPC thread, per memory region
+  UpdateBlockStats real3DUpdates; // Real3D update blocks replayed at vblank
+  TextureUploadStats real3DTextures; // Real3D texture uploads before and after merging
   UINT32 renderTicks;
   UINT32 sndTicks;
   UINT32 drvTicks;
@@ -68,6 +71,18 @@ struct FrameTimings
   UINT64 frameId;
 };
 
+/*
+ * StateHashes
+ *
+ * Checksums of the main memory regions, for comparing emulator runs
+ */
+struct StateHashes
+{
+  UINT32 ram;       // PowerPC main RAM
+  UINT32 real3D;    // Real3D memory
+  UINT32 soundRAM;  // sound board (68K/SCSP) RAM
+};
+
 /*
  * CModel3:
  *
@@ -87,6 +102,7 @@ public:
   bool ResumeThreads(void);
   void SaveState(CBlockFile *SaveState);
   void LoadState(CBlockFile *SaveState);
+  void RestoreState(CBlockFile *SaveState);
   void SaveNVRAM(CBlockFile *NVRAM);
   void LoadNVRAM(CBlockFile *NVRAM);
   void ClearNVRAM(void);
@@ -130,6 +146,22 @@ public:
    */
   Result LoadGame(const Game &game, const ROMSet &rom_set);
 
+  /*
+   * GetROMDestination(region_name, region_size):
+   *
+   * Returns the location of a ROM region in the memory pool, along with the
+   * word size LoadGame() would otherwise byte swap it to.
+   *
+   * Parameters:
+   *    region_name   ROM region name from the game XML.
+   *    region_size   Size of the region in bytes.
+   *
+   * Returns:
+   *    Destination, or one with a null pointer if the region is unknown or
+   *    has to be copied (e.g., because it is too large).
+   */
+  ROMDestination GetROMDestination(const std::string &region_name, size_t region_size);
+
   /*
    * GetSoundBoard(void):
    *
@@ -176,6 +208,14 @@ public:
    */
   FrameTimings GetTimings(void);
 
+  /*
+   * HashState(void):
+   *
+   * Returns checksums of main RAM, Real3D memory and sound board RAM. Threads
+   * must be paused (or not in use).
+   */
+  StateHashes HashState(void) const;
+
   /*
    * CModel3(config):
    * ~CModel3(void):
@@ -206,6 +246,7 @@ private:
   void      SetCROMBank(unsigned idx);
   UINT8     ReadSystemRegister(unsigned reg) const;
   void      WriteSystemRegister(unsigned reg, UINT8 data);
+  void      LoadState(CBlockFile *SaveState, bool restore);
 
   void RunMainBoardFrame(void);                       // Runs PPC main board for a frame
   void SyncGPUs(void);                                // Sync's up GPUs in preparation for rendering - must be called when PPC is not running
@@ -273,6 +314,7 @@ private:
   // Banked CROM
   UINT8     *cromBank;    // currently mapped in CROM bank
   unsigned  cromBankReg;  // the CROM bank register
+  unsigned  cromBankMask; // banks that exist (0x7 if banked CROM is mirrored above 64 MB)
 
   // Security device
   bool      m_securityFirstRead = true;
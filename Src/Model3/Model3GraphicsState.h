@@ -110,7 +110,7 @@ public:
     m_game = game;
     if (rom_set.get_rom("vrom").size <= 32*0x100000)
     {
-      rom_set.get_rom("vrom").CopyTo(&m_vrom.get()[0], 32*100000);
+      rom_set.get_rom("vrom").CopyTo(&m_vrom.get()[0], 32*0x100000);
       rom_set.get_rom("vrom").CopyTo(&m_vrom.get()[32*0x100000], 32*0x100000);
     }
     else
@@ -120,6 +120,11 @@ public:
     return Result::OKAY;
   }
 
+  ROMDestination GetROMDestination(const std::string &region_name, size_t region_size) override
+  {
+    return ROMDestination();
+  }
+
   void AttachRenderers(CRender2D *render2D, IRender3D *render3D, SuperAA* superAA) override
   {
     m_tileGen.AttachRenderer(render2D);
@@ -41,17 +41,28 @@
  Emulation Functions
 ******************************************************************************/
 
+// Saturday, January 1, 2000, 00:00:00
+static struct tm s_fixedTime = { 0, 0, 0, 1, 0, 100, 6, 0, 0 };
+
 UINT8 CRTC72421::ReadRegister(unsigned reg)
 {
 	static time_t oldTime{0};
 	time_t currentTime;
 	static struct tm *Time;
 
-	time(&currentTime);
-	if (currentTime != oldTime)
+	if (m_fixedTime)
+	{
+		Time = &s_fixedTime;
+		oldTime = 0;
+	}
+	else
 	{
-		Time = localtime(&currentTime);
-		oldTime = currentTime;
+		time(&currentTime);
+		if (currentTime != oldTime)
+		{
+			Time = localtime(&currentTime);
+			oldTime = currentTime;
+		}
 	}
 
 	switch (reg&0xF)
@@ -108,9 +119,9 @@ void CRTC72421::Reset(void)
  Initialization and Shutdown
 ******************************************************************************/
 
-void CRTC72421::Init(void)
+void CRTC72421::Init(bool fixedTime)
 {
-	// this function really only exists for consistency with other device classes
+	m_fixedTime = fixedTime;
 }
 
 CRTC72421::CRTC72421(void)
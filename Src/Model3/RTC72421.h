@@ -71,12 +71,17 @@ public:
 	void Reset(void);
 	
 	/*
-	 * Init(void):
+	 * Init(fixedTime):
 	 *
 	 * One-time initialization of the context. Must be called prior to all
 	 * other members.
+	 *
+	 * Parameters:
+	 *		fixedTime	If true, the clock always reads 2000-01-01 00:00:00
+	 *					instead of the host time, so that runs are
+	 *					repeatable.
 	 */
-	void Init(void);
+	void Init(bool fixedTime);
 	 
 	/*
 	 * CRTC72421(void):
@@ -86,6 +91,9 @@ public:
 	 */
 	CRTC72421(void);
 	~CRTC72421(void);
+
+private:
+	bool	m_fixedTime = false;
 };
 
 
@@ -51,11 +51,22 @@
 
 #include "Supermodel.h"
 #include "JTAG.h"
+#include "TextureTiles.h"
 #include "CPU/PowerPC/ppc.h"
+#include "OSD/VirtualMemory.h"
 #include "Util/BMPFile.h"
 #include "Util/BitCast.h"
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <zlib.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // Macros that divide memory regions into pages and mark them as dirty when they are written to
 #define PAGE_WIDTH 12
@@ -63,6 +74,23 @@
 #define DIRTY_SIZE(arraySize) (1+((arraySize)-1)/(8*PAGE_SIZE))
 #define MARK_DIRTY(dirtyArray, addr) dirtyArray[(addr)>>(PAGE_WIDTH+3)] |= 1<<(((addr)>>PAGE_WIDTH)&7)
 
+// Marks all pages overlapping the byte range [start, end) as dirty
+static void MarkDirtyRange(uint8_t *dirty, uint32_t start, uint32_t end)
+{
+  unsigned first = start >> PAGE_WIDTH;
+  unsigned last = (end - 1) >> PAGE_WIDTH;
+  uint8_t firstMask = uint8_t(0xFF << (first & 7));
+  uint8_t lastMask = uint8_t(0xFF >> (7 - (last & 7)));
+  if (first / 8 == last / 8)
+    dirty[first / 8] |= firstMask & lastMask;
+  else
+  {
+    dirty[first / 8] |= firstMask;
+    memset(&dirty[first / 8 + 1], 0xFF, last / 8 - first / 8 - 1);
+    dirty[last / 8] |= lastMask;
+  }
+}
+
 // Offsets of memory regions within Real3D memory pool
 #define OFFSET_8C           0x0000000 // 4 MB, culling RAM low (at 0x8C000000)
 #define OFFSET_8E           0x0400000 // 1 MB, culling RAM high (at 0x8E000000)
@@ -80,7 +108,11 @@
 #define OFFSET_98_DIRTY     (OFFSET_8E_DIRTY+DIRTY_SIZE(0x100000))
 #define OFFSET_TEXRAM_DIRTY (OFFSET_98_DIRTY+DIRTY_SIZE(0x400000))
 #define MEM_POOL_SIZE_DIRTY (DIRTY_SIZE(MEM_POOL_SIZE_RO))
-#define MEMORY_POOL_SIZE  (MEM_POOL_SIZE_RW+MEM_POOL_SIZE_RO+MEM_POOL_SIZE_DIRTY)
+#define OFFSET_8C_STALE     (OFFSET_8C_DIRTY+MEM_POOL_SIZE_DIRTY)
+#define OFFSET_8E_STALE     (OFFSET_8C_STALE+DIRTY_SIZE(0x400000))
+#define OFFSET_98_STALE     (OFFSET_8E_STALE+DIRTY_SIZE(0x100000))
+#define OFFSET_TEXRAM_STALE (OFFSET_98_STALE+DIRTY_SIZE(0x400000))
+#define MEMORY_POOL_SIZE  (MEM_POOL_SIZE_RW+MEM_POOL_SIZE_RO+2*MEM_POOL_SIZE_DIRTY)
 
 
 /******************************************************************************
@@ -91,7 +123,15 @@ void CReal3D::SaveState(CBlockFile *SaveState)
 {
   SaveState->NewBlock("Real3D", __FILE__);
 
-  SaveState->Write(memoryPool, MEM_POOL_SIZE_RW); // Don't write out read-only snapshots or dirty page arrays
+  // Don't write out read-only snapshots or dirty page arrays. The regions may
+  // have been swapped with their snapshots, so they are written one by one in
+  // the original memory pool order.
+  SyncLiveMemory();
+  SaveState->Write(cullingRAMLo, 0x400000);
+  SaveState->Write(cullingRAMHi, 0x100000);
+  SaveState->Write(polyRAM, 0x400000);
+  SaveState->Write(textureRAM, 0x800000);
+  SaveState->Write(textureFIFO, 0x100000);
   SaveState->Write(&fifoIdx, sizeof(fifoIdx));
   SaveState->Write(m_vromTextureFIFO, sizeof(m_vromTextureFIFO));
 
@@ -136,12 +176,64 @@ void CReal3D::LoadState(CBlockFile *SaveState)
     return;
   }
 
-  SaveState->Read(memoryPool, MEM_POOL_SIZE_RW);
+  SaveState->Read(cullingRAMLo, 0x400000);
+  SaveState->Read(cullingRAMHi, 0x100000);
+  SaveState->Read(polyRAM, 0x400000);
+  SaveState->Read(textureRAM, 0x800000);
+  SaveState->Read(textureFIFO, 0x100000);
 
   // If multi-threaded, update read-only snapshots too
   if (m_gpuMultiThreaded)
-    UpdateSnapshots(true);
+    CopySnapshots();
   Render3D->UploadTextures(0, 0, 0, 2048, 2048);
+  LoadRegisters(SaveState);
+}
+
+/*
+ * Reads a memory region from a save state a page at a time, only writing the
+ * pages that differ from what is already there. These are marked in the dirty
+ * page bitmap and, if given, in changed (which must be cleared beforehand).
+ */
+static void RestorePages(CBlockFile *SaveState, uint8_t *dst, unsigned size, uint8_t *dirty, uint8_t *changed = nullptr)
+{
+  uint8_t page[PAGE_SIZE];
+  for (unsigned offset = 0; offset < size; offset += PAGE_SIZE)
+  {
+    SaveState->Read(page, PAGE_SIZE);
+    if (!memcmp(&dst[offset], page, PAGE_SIZE))
+      continue;
+    memcpy(&dst[offset], page, PAGE_SIZE);
+    if (dirty)
+      MARK_DIRTY(dirty, offset);
+    if (changed)
+      MARK_DIRTY(changed, offset);
+  }
+}
+
+void CReal3D::RestoreState(CBlockFile *SaveState)
+{
+  if (Result::OKAY != SaveState->FindBlock("Real3D"))
+  {
+    ErrorLog("Unable to load Real3D GPU state. Save state file is corrupt.");
+    return;
+  }
+
+  // The snapshots are left alone. Pages that change are marked dirty (the
+  // bitmaps only exist when multi-threaded) and go out with the next swap,
+  // once the live regions have caught up with it.
+  SyncLiveMemory();
+  uint8_t changedRows[DIRTY_SIZE(0x800000)] = {};
+  RestorePages(SaveState, (uint8_t*)cullingRAMLo, 0x400000, cullingRAMLoDirty);
+  RestorePages(SaveState, (uint8_t*)cullingRAMHi, 0x100000, cullingRAMHiDirty);
+  RestorePages(SaveState, (uint8_t*)polyRAM,      0x400000, polyRAMDirty);
+  RestorePages(SaveState, (uint8_t*)textureRAM,   0x800000, textureRAMDirty, changedRows);
+  SaveState->Read(textureFIFO, 0x100000);
+  UploadTextureRows(changedRows);
+  LoadRegisters(SaveState);
+}
+
+void CReal3D::LoadRegisters(CBlockFile *SaveState)
+{
   SaveState->Read(&fifoIdx, sizeof(fifoIdx));
   SaveState->Read(&m_vromTextureFIFO, sizeof(m_vromTextureFIFO));
 
@@ -176,6 +268,18 @@ void CReal3D::LoadState(CBlockFile *SaveState)
   
 }
 
+uint32_t CReal3D::HashMemory(void) const
+{
+  // Same result as hashing the read-write part of the memory pool in one go
+  SyncLiveMemory();
+  uLong crc = crc32(0, (const Bytef *) cullingRAMLo, 0x400000);
+  crc = crc32(crc, (const Bytef *) cullingRAMHi, 0x100000);
+  crc = crc32(crc, (const Bytef *) polyRAM, 0x400000);
+  crc = crc32(crc, (const Bytef *) textureRAM, 0x800000);
+  crc = crc32(crc, (const Bytef *) textureFIFO, 0x100000);
+  return uint32_t(crc);
+}
+
 
 /******************************************************************************
  Rendering
@@ -188,6 +292,7 @@ void CReal3D::BeginVBlank()
     m_pingPongCopy = m_pingPong;
 
     // sync any update buffers
+    m_updateBlockStats = UpdateBlockStats();
     SyncBufferedMem(m_highRamUpdateBlock, cullingRAMLo, cullingRAMHi, cullingRAMHiDirty);
     SyncBufferedMem(m_polyUpdateBlock, cullingRAMLo + m_configRegisters.pingPongMemSize, polyRAM, polyRAMDirty);
 
@@ -226,60 +331,171 @@ uint32_t CReal3D::SyncSnapshots(void)
   if (!m_gpuMultiThreaded)
     return 0;
 
-  // Update read-only queue
-  queuedUploadTexturesRO = queuedUploadTextures;
+  // Update read-only queue (appended to, in case the last frame was not rendered)
+  queuedUploadTexturesRO.insert(queuedUploadTexturesRO.end(), queuedUploadTextures.begin(), queuedUploadTextures.end());
   queuedUploadTextures.clear();
 
   Render3D->SetBlockCulling(m_blockCullingRO);
 
   // Update read-only snapshots
-  return UpdateSnapshots(false);
+  return SwapSnapshots();
+}
+
+// Dirty page bitmaps are scanned 64 pages at a time (bit n of byte i is page 8*i+n)
+static inline uint64_t LoadDirtyBits(const uint8_t *dirty)
+{
+  uint64_t bits = 0;
+  for (int i = 7; i >= 0; i--)
+    bits = (bits << 8) | dirty[i];
+  return bits;
 }
 
-uint32_t CReal3D::UpdateSnapshot(bool copyWhole, uint8_t *src, uint8_t *dst, unsigned size, uint8_t *dirty)
+static inline unsigned CountTrailingZeros(uint64_t bits)
 {
-  unsigned dirtySize = DIRTY_SIZE(size);
-  if (copyWhole)
+#if defined(__GNUC__)
+  return unsigned(__builtin_ctzll(bits));
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long idx;
+  _BitScanForward64(&idx, bits);
+  return unsigned(idx);
+#else
+  unsigned n = 0;
+  while (!(bits & 1))
   {
-    // If updating whole region, then just copy all data in one go
-    memcpy(dst, src, size);
-    memset(dirty, 0, dirtySize);
-    return size;
+    bits >>= 1;
+    n++;
   }
-  else
+  return n;
+#endif
+}
+
+// Returns the first page at or after page whose dirty bit equals set, or numPages
+static unsigned FindDirtyPage(const uint8_t *dirty, unsigned page, unsigned numPages, bool set)
+{
+  while (page < numPages)
+  {
+    uint64_t bits = LoadDirtyBits(&dirty[(page / 64) * 8]);
+    if (!set)
+      bits = ~bits;
+    bits &= ~uint64_t(0) << (page % 64);
+    if (bits)
+      return std::min(numPages, (page & ~63u) + CountTrailingZeros(bits));
+    page = (page & ~63u) + 64;
+  }
+  return numPages;
+}
+
+// Copies a run of dirty pages. Runs larger than the cache are written with
+// non-temporal stores so that they do not evict everything else on the way.
+static void CopyPages(uint8_t *dst, const uint8_t *src, size_t size)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+  if (size >= 0x40000 && (uintptr_t(dst) & 15) == 0 && (uintptr_t(src) & 15) == 0 && (size & 63) == 0)
   {
-    // Otherwise, loop through dirty pages array to find out what needs to be updated and copy only those parts
-    uint32_t copied = 0;
-    uint8_t *pSrc = src;
-    uint8_t *pDst = dst;
-    for (unsigned i = 0; i < dirtySize; i++)
+    __m128i *d = (__m128i *) dst;
+    const __m128i *s = (const __m128i *) src;
+    for (size_t i = 0; i < size / 16; i += 4)
     {
-      uint8_t d = dirty[i];
-      if (d)
-      {
-        for (unsigned j = 0; j < 8; j++)
-        {
-          if (d&1)
-          {
-            // If not at very end of region, then copy an extra 4 bytes to allow for a possible 32-bit overlap
-            uint32_t toCopy = (i < dirtySize - 1 || j < 7 ? PAGE_SIZE + 4 : PAGE_SIZE);
-            memcpy(pDst, pSrc, toCopy);
-            copied += toCopy;
-          }
-          d >>= 1;
-          pSrc += PAGE_SIZE;
-          pDst += PAGE_SIZE;
-        }
-        dirty[i] = 0;
-      }
-      else
-      {
-        pSrc += 8 * PAGE_SIZE;
-        pDst += 8 * PAGE_SIZE;
-      }
+      __m128i a = _mm_load_si128(s + i + 0);
+      __m128i b = _mm_load_si128(s + i + 1);
+      __m128i c = _mm_load_si128(s + i + 2);
+      __m128i e = _mm_load_si128(s + i + 3);
+      _mm_stream_si128(d + i + 0, a);
+      _mm_stream_si128(d + i + 1, b);
+      _mm_stream_si128(d + i + 2, c);
+      _mm_stream_si128(d + i + 3, e);
     }
-    return copied;
+    _mm_sfence();
+    return;
   }
+#endif
+  memcpy(dst, src, size);
+}
+
+// Copies the pages marked in a dirty page bitmap, a run of consecutive pages
+// at a time, and clears the bitmap. Returns the number of bytes copied.
+static uint32_t CopyDirtyPages(uint8_t *dst, const uint8_t *src, unsigned size, uint8_t *dirty)
+{
+  // All regions are a multiple of 64 pages, so the bitmaps are too
+  unsigned numPages = size / PAGE_SIZE;
+  unsigned page = FindDirtyPage(dirty, 0, numPages, true);
+  if (page >= numPages)
+    return 0;
+  uint32_t copied = 0;
+  do
+  {
+    unsigned end = FindDirtyPage(dirty, page, numPages, false);
+    size_t offset = size_t(page) * PAGE_SIZE;
+    size_t runSize = size_t(end - page) * PAGE_SIZE;
+    CopyPages(&dst[offset], &src[offset], runSize);
+    // If not at very end of region, then copy an extra 4 bytes to allow for a possible 32-bit overlap
+    if (end < numPages)
+    {
+      memcpy(&dst[offset + runSize], &src[offset + runSize], 4);
+      runSize += 4;
+    }
+    copied += uint32_t(runSize);
+    page = FindDirtyPage(dirty, end, numPages, true);
+  } while (page < numPages);
+  memset(dirty, 0, DIRTY_SIZE(size));
+  return copied;
+}
+
+static unsigned CountDirtyPages(const uint8_t *dirty, unsigned numPages)
+{
+  unsigned count = 0;
+  for (unsigned i = 0; i < numPages / 64; i++)
+  {
+    uint64_t bits = LoadDirtyBits(&dirty[i * 8]);
+    while (bits)
+    {
+      bits &= bits - 1;
+      count++;
+    }
+  }
+  return count;
+}
+
+/*
+ * Instead of copying the dirty pages of a region into its snapshot, the two
+ * are swapped: the region as written this frame becomes the snapshot, and the
+ * old snapshot becomes the region the PPC writes to. It is only out of date
+ * in the pages that were dirty, which are recorded in the stale page bitmap
+ * and copied back by SyncLiveMemory() on the PPC thread, while the render
+ * thread is drawing. The dirty and stale bitmaps swap roles with the regions.
+ */
+template <typename T>
+uint32_t CReal3D::SwapSnapshot(T *&live, T *&snapshot, uint8_t *&dirty, uint8_t *&stale, unsigned size)
+{
+  uint32_t dirtyBytes = CountDirtyPages(dirty, size / PAGE_SIZE) * PAGE_SIZE;
+  if (dirtyBytes)
+  {
+    std::swap(live, snapshot);
+    std::swap(dirty, stale);
+  }
+  return dirtyBytes;
+}
+
+void CReal3D::SyncLiveMemory(void) const
+{
+  if (!m_gpuMultiThreaded)
+    return;
+
+  // Only the memory contents change, not the pointers, hence const
+  auto sync = [this](void *live, const void *snapshot, unsigned size, uint8_t *stale, SnapshotStats::Region region)
+  {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t copied = CopyDirtyPages((uint8_t*)live, (const uint8_t*)snapshot, size, stale);
+    if (copied)
+    {
+      m_liveSyncStats.bytes[region] += copied;
+      m_liveSyncStats.micros[region] += uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+  };
+  sync(cullingRAMLo, cullingRAMLoRO, 0x400000, cullingRAMLoStale, SnapshotStats::CullingRAMLo);
+  sync(cullingRAMHi, cullingRAMHiRO, 0x100000, cullingRAMHiStale, SnapshotStats::CullingRAMHi);
+  sync(polyRAM,      polyRAMRO,      0x400000, polyRAMStale,      SnapshotStats::PolyRAM);
+  sync(textureRAM,   textureRAMRO,   0x800000, textureRAMStale,   SnapshotStats::TextureRAM);
 }
 
 void CReal3D::SyncBufferedMem(UpdateBlock* updateBlock, uint32_t* updateBuffer, uint32_t* dst, uint8_t* dirty)
@@ -293,16 +509,16 @@ void CReal3D::SyncBufferedMem(UpdateBlock* updateBlock, uint32_t* updateBuffer,
             auto count      = ub->Count();
             auto startAddr  = ub->startAddr;
 
-            for (auto i = 0u; i < count; i++) {
+            // blocks are contiguous runs of words, so copy and mark them in one go
+            memcpy(&dst[startAddr], ub->data, count * 4);
 
-                auto addr = startAddr + i;
-                dst[addr] = ub->data[i];
-
-                if (m_gpuMultiThreaded) {
-                    MARK_DIRTY(dirty, (addr*4));
-                }
+            if (m_gpuMultiThreaded) {
+                MarkDirtyRange(dirty, startAddr * 4, (startAddr + count) * 4);
             }
 
+            m_updateBlockStats.blocks++;
+            m_updateBlockStats.bytes += count * 4;
+
             if (ub == updateBlock) break;      // last block
 
             ub = ub->Next();    
@@ -377,15 +593,105 @@ void CReal3D::TilegenDrawFrame(uint32_t flags)
     }
 }
 
-uint32_t CReal3D::UpdateSnapshots(bool copyWhole)
+uint32_t CReal3D::SwapSnapshots(void)
 {
-  // Update all memory region snapshots
-  uint32_t cullLoCopied  = UpdateSnapshot(copyWhole, (uint8_t*)cullingRAMLo, (uint8_t*)cullingRAMLoRO, 0x400000, cullingRAMLoDirty);
-  uint32_t cullHiCopied  = UpdateSnapshot(copyWhole, (uint8_t*)cullingRAMHi, (uint8_t*)cullingRAMHiRO, 0x100000, cullingRAMHiDirty);
-  uint32_t polyCopied    = UpdateSnapshot(copyWhole, (uint8_t*)polyRAM,      (uint8_t*)polyRAMRO,      0x400000, polyRAMDirty);
-  uint32_t textureCopied = UpdateSnapshot(copyWhole, (uint8_t*)textureRAM,   (uint8_t*)textureRAMRO,   0x800000, textureRAMDirty);
-  //printf("Read3D copied - cullLo:%4uK, cullHi:%4uK, poly:%4uK, texture:%4uK\n", cullLoCopied / 1024, cullHiCopied / 1024, polyCopied / 1024, textureCopied / 1024);
-  return cullLoCopied + cullHiCopied + polyCopied + textureCopied;
+  const uint32_t *oldCullingRAMLo = cullingRAMLo;
+
+  // Catch up first if no PPC frame has run since the last swap, then report
+  // what the PPC thread spent bringing its memory up to date this frame
+  SyncLiveMemory();
+  m_snapshotStats = m_liveSyncStats;
+  m_liveSyncStats = {};
+
+  uint32_t swapped = 0;
+  swapped += SwapSnapshot(cullingRAMLo, cullingRAMLoRO, cullingRAMLoDirty, cullingRAMLoStale, 0x400000);
+  swapped += SwapSnapshot(cullingRAMHi, cullingRAMHiRO, cullingRAMHiDirty, cullingRAMHiStale, 0x100000);
+  swapped += SwapSnapshot(polyRAM,      polyRAMRO,      polyRAMDirty,      polyRAMStale,      0x400000);
+  swapped += SwapSnapshot(textureRAM,   textureRAMRO,   textureRAMDirty,   textureRAMStale,   0x800000);
+
+  // Update buffers live in low culling RAM until the next vblank
+  if (cullingRAMLo != oldCullingRAMLo)
+  {
+    if (m_polyUpdateBlock)
+      m_polyUpdateBlock = (UpdateBlock*)(cullingRAMLo + ((const uint32_t*)m_polyUpdateBlock - oldCullingRAMLo));
+    if (m_highRamUpdateBlock)
+      m_highRamUpdateBlock = (UpdateBlock*)(cullingRAMLo + ((const uint32_t*)m_highRamUpdateBlock - oldCullingRAMLo));
+  }
+
+  if (swapped)
+    Render3D->AttachMemory(cullingRAMLoRO, cullingRAMHiRO, polyRAMRO, vrom, textureRAMRO);
+  return swapped;
+}
+
+void CReal3D::CopySnapshots(void)
+{
+  memcpy(cullingRAMLoRO, cullingRAMLo, 0x400000);
+  memcpy(cullingRAMHiRO, cullingRAMHi, 0x100000);
+  memcpy(polyRAMRO, polyRAM, 0x400000);
+  memcpy(textureRAMRO, textureRAM, 0x800000);
+  memset(&memoryPool[OFFSET_8C_DIRTY], 0, 2*MEM_POOL_SIZE_DIRTY); // dirty and stale page arrays
+}
+
+/*
+ * Combines queued texture uploads so that fewer, larger ones are passed to the
+ * renderer. Uploads of the same mip level are merged into rows where they have
+ * the same vertical extent and overlap or touch, then rows are merged into
+ * columns the same way, so no texel that was not queued gets uploaded. Uploads
+ * never span both texture sheets. If most of texture RAM ends up covered, one
+ * upload of everything replaces them.
+ */
+static void MergeTextureUploads(std::vector<QueuedUploadTextures> &uploads)
+{
+  if (uploads.size() < 2)
+    return;
+
+  std::sort(uploads.begin(), uploads.end(), [](const QueuedUploadTextures &a, const QueuedUploadTextures &b)
+  {
+    return std::tie(a.level, a.y, a.height, a.x) < std::tie(b.level, b.y, b.height, b.x);
+  });
+  size_t n = 0;
+  for (const auto &u : uploads)
+  {
+    if (n > 0)
+    {
+      auto &last = uploads[n - 1];
+      if (last.level == u.level && last.y == u.y && last.height == u.height && u.x <= last.x + last.width)
+      {
+        last.width = std::max(last.x + last.width, u.x + u.width) - last.x;
+        continue;
+      }
+    }
+    uploads[n++] = u;
+  }
+  uploads.resize(n);
+
+  std::sort(uploads.begin(), uploads.end(), [](const QueuedUploadTextures &a, const QueuedUploadTextures &b)
+  {
+    return std::tie(a.level, a.x, a.width, a.y) < std::tie(b.level, b.x, b.width, b.y);
+  });
+  n = 0;
+  size_t coverage = 0;
+  for (const auto &u : uploads)
+  {
+    if (n > 0)
+    {
+      auto &last = uploads[n - 1];
+      if (last.level == u.level && last.x == u.x && last.width == u.width && u.y <= last.y + last.height && u.y / 1024 == last.y / 1024)
+      {
+        unsigned bottom = std::max(last.y + last.height, u.y + u.height);
+        coverage += size_t(bottom - (last.y + last.height)) * last.width;
+        last.height = bottom - last.y;
+        continue;
+      }
+    }
+    uploads[n++] = u;
+    coverage += size_t(u.width) * u.height;
+  }
+  uploads.resize(n);
+
+  // A full upload is what a save state load does
+  if (coverage >= (2048 * 2048) / 2)
+    uploads.assign(1, QueuedUploadTextures{ 0, 0, 0, 2048, 2048 });
 }
 
 void CReal3D::BeginFrame(void)
@@ -393,6 +699,10 @@ void CReal3D::BeginFrame(void)
   // If multi-threaded, perform now any queued texture uploads to renderer before rendering begins
   if (m_gpuMultiThreaded)
   {
+    m_textureUploadStats.queued = uint32_t(queuedUploadTexturesRO.size());
+    MergeTextureUploads(queuedUploadTexturesRO);
+    m_textureUploadStats.uploaded = uint32_t(queuedUploadTexturesRO.size());
+
     for (const auto &it : queuedUploadTexturesRO) {
       Render3D->UploadTextures(it.level, it.x, it.y, it.width, it.height);
     }
@@ -425,76 +735,30 @@ static constexpr int mipXBase[] = { 0, 1024, 1536, 1792, 1920, 1984, 2016, 2032,
 static constexpr int mipYBase[] = { 0, 512, 768, 896, 960, 992, 1008, 1016, 1020, 1022, 1023 };
 static constexpr int mipDivisor[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
 
-// Tables of texel offsets corresponding to an NxN texel texture tile
-
-static constexpr unsigned decode8x8[64] =
-{
-   1, 0, 5, 4, 9, 8,13,12,
-   3, 2, 7, 6,11,10,15,14,
-  17,16,21,20,25,24,29,28,
-  19,18,23,22,27,26,31,30,
-  33,32,37,36,41,40,45,44,
-  35,34,39,38,43,42,47,46,
-  49,48,53,52,57,56,61,60,
-  51,50,55,54,59,58,63,62
-};
-
-static constexpr unsigned decode8x4[32] =
-{
-   1, 0, 5, 4,
-   3, 2, 7, 6,
-   9, 8,13,12,
-  11,10,15,14,
-  17,16,21,20,
-  19,18,23,22,
-  25,24,29,28,
-  27,26,31,30
-};
-
-static constexpr unsigned decode8x2[16] =
-{
-   1, 0,
-   3, 2,
-   5, 4,
-   7, 6,
-   9, 8,
-  11, 10,
-  13, 12,
-  15, 14
-};
-
 void CReal3D::StoreTexture(unsigned level, unsigned xPos, unsigned yPos, unsigned width, unsigned height, const uint16_t *texData, bool sixteenBit, bool writeLSB, bool writeMSB, uint32_t &texDataOffset)
 {
   const uint32_t tileX = (std::min)(8u, width);
   const uint32_t tileY = (std::min)(8u, height);
 
-  const unsigned* const decode = (tileX == 8) ? decode8x8 : (tileX == 4) ? decode8x4 : (tileX == 2) ? decode8x2 : nullptr;
+  // Each texture RAM row is a page, so mark the rows written all at once
+  const uint32_t firstByte = (yPos * 2048 + xPos) * 2;
+  const uint32_t lastByte = ((yPos + height - 1) * 2048 + xPos + width) * 2;
 
   texDataOffset = 0;
 
   if (sixteenBit)  // 16-bit textures
   {
-    // Outer 2 loops: NxN tiles
+    if (m_gpuMultiThreaded)
+      MarkDirtyRange(textureRAMDirty, firstByte, lastByte);
+
+    // Loop over NxN tiles
     for (uint32_t y = yPos; y < (yPos + height); y += tileY)
     {
       for (uint32_t x = xPos; x < (xPos + width); x += tileX)
       {
-        // Inner 2 loops: NxN texels for the current tile
-        uint32_t destOffset = y * 2048 + x;
-        for (uint32_t yy = 0; yy < tileY; yy++)
-        {
-          for (uint32_t xx = 0; xx < tileX; xx++)
-          {
-            if (m_gpuMultiThreaded)
-              MARK_DIRTY(textureRAMDirty, destOffset * 2);
-
-            textureRAM[destOffset++] = texData[decode[yy * tileX + xx]];
-
-            texDataOffset++;
-          }
-          destOffset += 2048 - tileX; // next line
-        }
+        TextureTiles::Store16(&textureRAM[y * 2048 + x], 2048, texData, tileX, tileY);
         texData += tileY * tileX; // next tile
+        texDataOffset += tileY * tileX;
       }
     }
   }
@@ -509,37 +773,20 @@ void CReal3D::StoreTexture(unsigned level, unsigned xPos, unsigned yPos, unsigne
     if (writeLSB && writeMSB)  // write to both?
       DebugLog("Observed 8-bit texture with byte_select=3!");
 
-    // Outer 2 loops: NxN tiles
     const uint8_t byteSelect = (uint8_t)writeLSB | ((uint8_t)writeMSB << 1);
     static constexpr uint16_t byteMask[4] = {0xFFFF, 0xFF00, 0x00FF, 0x0000};
+    const bool write = writeLSB | writeMSB;
+    if (write && m_gpuMultiThreaded)
+      MarkDirtyRange(textureRAMDirty, firstByte, lastByte);
+
+    // Loop over NxN tiles
     const uint32_t offset = std::max(1u, (tileY * tileX) / 2);
     for (uint32_t y = yPos; y < (yPos + height); y += tileY)
     {
       for (uint32_t x = xPos; x < (xPos + width); x += tileX)
       {
-        // Inner 2 loops: NxN texels for the current tile
-        uint32_t destOffset = y * 2048 + x;
-        for (uint32_t yy = 0; yy < tileY; yy++)
-        {
-          for (uint32_t xx = 0; xx < tileX; xx++)
-          {
-            if (writeLSB | writeMSB) {
-              if (m_gpuMultiThreaded)
-                MARK_DIRTY(textureRAMDirty, destOffset * 2);
-              textureRAM[destOffset] &= byteMask[byteSelect];
-              const uint8_t shift = (8 * ((xx & 1) ^ 1));
-              const uint8_t index = (yy ^ 1) * tileX + (xx ^ 1) - (tileX & 1);
-
-              uint16_t tempData = (texData[decode[index] / 2] >> shift) & 0xFF;
-
-              tempData |= tempData << 8;
-              tempData &= byteMask[byteSelect] ^ 0xFFFF;
-              textureRAM[destOffset] |= tempData;
-            }
-            destOffset++;
-          }
-          destOffset += 2048 - tileX; // next line
-        }
+        if (write)
+          TextureTiles::Store8(&textureRAM[y * 2048 + x], 2048, texData, tileX, tileY, byteMask[byteSelect]);
         texData += offset; // next tile
         texDataOffset += offset; // next tile
       }
@@ -548,6 +795,11 @@ void CReal3D::StoreTexture(unsigned level, unsigned xPos, unsigned yPos, unsigne
 
   // Signal to renderer that textures have changed
   // TO-DO: mipmaps? What if a game writes non-mipmap textures to mipmap area?
+  QueueTextureUpload(level, xPos, yPos, width, height);
+}
+
+void CReal3D::QueueTextureUpload(unsigned level, unsigned xPos, unsigned yPos, unsigned width, unsigned height)
+{
   if (m_gpuMultiThreaded)
   {
     // If multi-threaded, then queue calls to UploadTextures for render thread to perform at beginning of next frame
@@ -563,6 +815,26 @@ void CReal3D::StoreTexture(unsigned level, unsigned xPos, unsigned yPos, unsigne
     Render3D->UploadTextures(level, xPos, yPos, width, height);
 }
 
+// Uploads runs of texture RAM rows (one page each) along with every mipmap
+// level that lies in them, which is what a full upload would cover
+void CReal3D::UploadTextureRows(const uint8_t *changedRows)
+{
+  unsigned row = FindDirtyPage(changedRows, 0, 2048, true);
+  while (row < 2048)
+  {
+    unsigned pageBase = row & ~1023u;
+    unsigned end = std::min(FindDirtyPage(changedRows, row, 2048, false), pageBase + 1024);
+    for (unsigned level = 0; level < sizeof(mipYBase) / sizeof(mipYBase[0]); level++)
+    {
+      unsigned top = std::max(row - pageBase, unsigned(mipYBase[level]));
+      unsigned bottom = std::min(end - pageBase, unsigned(mipYBase[level] + 1024 / mipDivisor[level]));
+      if (top < bottom)
+        QueueTextureUpload(level, mipXBase[level], pageBase + top, 2048 / mipDivisor[level], bottom - top);
+    }
+    row = FindDirtyPage(changedRows, end, 2048, true);
+  }
+}
+
 /*
 Texture header:
 -------- -------- -------- --xxxxxx X-position
@@ -835,6 +1107,16 @@ void CReal3D::WriteTexturePort(unsigned reg, uint32_t data)
   }
 }
 
+// Update blocks live in low culling RAM, so they have to be carried through snapshot swaps like any other write
+void CReal3D::MarkUpdateBlockDirty(const UpdateBlock* updateBlock, uint32_t offset)
+{
+  uint32_t headerAddr = uint32_t((const uint32_t*)updateBlock - cullingRAMLo) * 4;
+  uint32_t dataAddr = uint32_t(&updateBlock->data[offset] - cullingRAMLo) * 4;
+  MARK_DIRTY(cullingRAMLoDirty, headerAddr);
+  MARK_DIRTY(cullingRAMLoDirty, headerAddr + 4);
+  MARK_DIRTY(cullingRAMLoDirty, dataAddr);
+}
+
 void CReal3D::WriteLowCullingRAM(uint32_t addr, uint32_t data)
 {
   if (m_gpuMultiThreaded)
@@ -864,6 +1146,10 @@ void CReal3D::WriteHighCullingRAM(uint32_t addr, uint32_t data)
       auto offset = m_highRamUpdateBlock->lastAddr - m_highRamUpdateBlock->startAddr;
 
       m_highRamUpdateBlock->data[offset] = data;
+
+      if (m_gpuMultiThreaded) {
+          MarkUpdateBlockDirty(m_highRamUpdateBlock, offset);
+      }
   }
   else {
       if (m_gpuMultiThreaded) {
@@ -894,6 +1180,10 @@ void CReal3D::WritePolygonRAM(uint32_t addr, uint32_t data)
         auto offset = m_polyUpdateBlock->lastAddr - m_polyUpdateBlock->startAddr;
 
         m_polyUpdateBlock->data[offset] = data;
+
+        if (m_gpuMultiThreaded) {
+            MarkUpdateBlockDirty(m_polyUpdateBlock, offset);
+        }
     }
     else {
         if (m_gpuMultiThreaded) {
@@ -1052,7 +1342,7 @@ void CReal3D::Reset(void)
   m_highRamUpdateBlock = nullptr;
 
   unsigned memSize = (m_gpuMultiThreaded ? MEMORY_POOL_SIZE : MEM_POOL_SIZE_RW);
-  memset(memoryPool, 0, memSize);
+  VirtualMemory::Discard(memoryPool, memSize);
   memset(m_vromTextureFIFO, 0, sizeof(m_vromTextureFIFO));
   memset(m_internalRenderConfig, 0, sizeof(m_internalRenderConfig));
 
@@ -1108,10 +1398,13 @@ Result CReal3D::Init(const uint8_t *vromPtr, IBus *BusObjectPtr, CIRQ *IRQObject
   IRQ = IRQObjectPtr;
   dmaIRQ = dmaIRQBit;
 
-  // Allocate all Real3D RAM regions
-  memoryPool = new(std::nothrow) uint8_t[memSize];
+  // Allocate all Real3D RAM regions. All of it is in use, so it may be backed
+  // by explicit huge pages.
+  VirtualMemory::PageType pageType;
+  memoryPool = (uint8_t *) VirtualMemory::Allocate(memSize, &pageType, true);
   if (NULL == memoryPool)
     return ErrorLog("Insufficient memory for Real3D object (needs %1.1f MB).", memSizeMB);
+  InfoLog("Real3D memory: %1.1f MB in %s.", memSizeMB, VirtualMemory::GetPageTypeName(pageType));
 
   // Set up main pointers
   cullingRAMLo = (uint32_t *) &memoryPool[OFFSET_8C];
@@ -1131,6 +1424,10 @@ Result CReal3D::Init(const uint8_t *vromPtr, IBus *BusObjectPtr, CIRQ *IRQObject
     cullingRAMHiDirty = (uint8_t *) &memoryPool[OFFSET_8E_DIRTY];
     polyRAMDirty = (uint8_t *) &memoryPool[OFFSET_98_DIRTY];
     textureRAMDirty = (uint8_t *) &memoryPool[OFFSET_TEXRAM_DIRTY];
+    cullingRAMLoStale = (uint8_t *) &memoryPool[OFFSET_8C_STALE];
+    cullingRAMHiStale = (uint8_t *) &memoryPool[OFFSET_8E_STALE];
+    polyRAMStale = (uint8_t *) &memoryPool[OFFSET_98_STALE];
+    textureRAMStale = (uint8_t *) &memoryPool[OFFSET_TEXRAM_STALE];
   }
 
   // VROM pointer passed to us
@@ -1227,7 +1524,7 @@ CReal3D::~CReal3D(void)
   }
 
   Render3D = nullptr;
-  delete [] memoryPool;
+  VirtualMemory::Free(memoryPool, m_gpuMultiThreaded ? MEMORY_POOL_SIZE : MEM_POOL_SIZE_RW);
   memoryPool = nullptr;
   cullingRAMLo = nullptr;
   cullingRAMHi = nullptr;
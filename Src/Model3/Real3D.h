@@ -55,6 +55,53 @@ struct QueuedUploadTextures
   unsigned height;
 };
 
+/*
+ * SnapshotStats:
+ *
+ * Amount of data the PPC thread copied back into each memory region from its
+ * read-only snapshot (CReal3D::SyncLiveMemory()) during the frame before the
+ * last call to CReal3D::SyncSnapshots(), and how long the copy took, for
+ * timing dumps. The swap itself costs next to nothing.
+ */
+struct SnapshotStats
+{
+  enum Region
+  {
+    CullingRAMLo,
+    CullingRAMHi,
+    PolyRAM,
+    TextureRAM,
+    NumRegions
+  };
+
+  uint32_t bytes[NumRegions];
+  uint32_t micros[NumRegions];
+};
+
+/*
+ * UpdateBlockStats:
+ *
+ * Number of buffered culling and polygon RAM update blocks replayed at the
+ * last vblank and how much data they held.
+ */
+struct UpdateBlockStats
+{
+  uint32_t blocks;
+  uint32_t bytes;
+};
+
+/*
+ * TextureUploadStats:
+ *
+ * Number of texture uploads queued for the last rendered frame and how many
+ * were passed to the renderer after merging.
+ */
+struct TextureUploadStats
+{
+  uint32_t queued;
+  uint32_t uploaded;
+};
+
 /*
  * CReal3D:
  *
@@ -103,6 +150,29 @@ public:
    */
   void LoadState(CBlockFile *SaveState);
 
+  /*
+   * RestoreState(SaveState):
+   *
+   * Loads a state image saved from the running machine a few frames earlier.
+   * Only memory pages that differ are written and only the texture rows that
+   * changed are uploaded, so this is much cheaper than LoadState() when
+   * little has changed. The read-only snapshots are updated by the next
+   * SyncSnapshots().
+   *
+   * Parameters:
+   *    SaveState   Block file to load state information from.
+   */
+  void RestoreState(CBlockFile *SaveState);
+
+  /*
+   * HashMemory(void):
+   *
+   * Returns:
+   *    CRC-32 of all Real3D memory (the part that is saved in save states),
+   *    for comparing emulator runs.
+   */
+  uint32_t HashMemory(void) const;
+
   /*
    * BeginVBlank(void):
    *
@@ -138,6 +208,53 @@ public:
    */
   uint32_t SyncSnapshots(void);
 
+  /*
+   * SyncLiveMemory(void):
+   *
+   * SyncSnapshots() hands the memory written during the frame to the renderer
+   * by swapping it with the read-only snapshot, leaving the PPC with memory
+   * that is out of date in the pages that were written. This brings those
+   * pages up to date from the snapshot. Must be called on the PPC thread
+   * before the next frame touches Real3D memory. Does nothing if
+   * multi-threaded rendering is not enabled.
+   */
+  void SyncLiveMemory(void) const;
+
+  /*
+   * GetSnapshotStats(void):
+   *
+   * Returns:
+   *    Per-region statistics for the frame ended by the last SyncSnapshots()
+   *    call.
+   */
+  const SnapshotStats &GetSnapshotStats(void) const
+  {
+    return m_snapshotStats;
+  }
+
+  /*
+   * GetUpdateBlockStats(void):
+   *
+   * Returns:
+   *    Statistics of the update blocks replayed at the last vblank.
+   */
+  const UpdateBlockStats &GetUpdateBlockStats(void) const
+  {
+    return m_updateBlockStats;
+  }
+
+  /*
+   * GetTextureUploadStats(void):
+   *
+   * Returns:
+   *    Statistics of the texture uploads of the last rendered frame (only
+   *    gathered when multi-threaded).
+   */
+  const TextureUploadStats &GetTextureUploadStats(void) const
+  {
+    return m_textureUploadStats;
+  }
+
   /*
    * BeginFrame(void):
    *
@@ -459,11 +576,17 @@ private:
 
   // Private member functions
   void      DMACopy(void);
+  void      MarkUpdateBlockDirty(const UpdateBlock* updateBlock, uint32_t offset);
+  void      LoadRegisters(CBlockFile *SaveState);
+  void      QueueTextureUpload(unsigned level, unsigned xPos, unsigned yPos, unsigned width, unsigned height);
+  void      UploadTextureRows(const uint8_t *changedRows);
   void      StoreTexture(unsigned level, unsigned xPos, unsigned yPos, unsigned width, unsigned height, const uint16_t *texData, bool sixteenBit, bool writeLSB, bool writeMSB, uint32_t &texDataOffset);
 
   void      UploadTexture(uint32_t header, const uint16_t *texData);
-  uint32_t  UpdateSnapshots(bool copyWhole);
-  uint32_t  UpdateSnapshot(bool copyWhole, uint8_t *src, uint8_t *dst, unsigned size, uint8_t *dirty);
+  uint32_t  SwapSnapshots(void);
+  template <typename T>
+  uint32_t  SwapSnapshot(T *&live, T *&snapshot, uint8_t *&dirty, uint8_t *&stale, unsigned size);
+  void      CopySnapshots(void);
   void      SyncBufferedMem(UpdateBlock* updateBlock, uint32_t* updateBuffer, uint32_t* dst, uint8_t* dirty);
   void      FlushTextures();
   bool      PollPingPong();
@@ -518,9 +641,18 @@ private:
   uint8_t   *polyRAMDirty = nullptr;
   uint8_t   *textureRAMDirty = nullptr;
 
+  // Pages of the above that are out of date after being swapped with their snapshots
+  uint8_t   *cullingRAMLoStale = nullptr;
+  uint8_t   *cullingRAMHiStale = nullptr;
+  uint8_t   *polyRAMStale = nullptr;
+  uint8_t   *textureRAMStale = nullptr;
+  SnapshotStats m_snapshotStats = {};       // reported for the last frame
+  mutable SnapshotStats m_liveSyncStats = {};  // accumulated by SyncLiveMemory() since the last swap
+
   // Queued texture uploads
   std::vector<QueuedUploadTextures> queuedUploadTextures;
   std::vector<QueuedUploadTextures> queuedUploadTexturesRO;  // Read-only copy of queue
+  TextureUploadStats m_textureUploadStats = {};
   
   // Big endian bus object for DMA memory access
   IBus  *Bus = nullptr;
@@ -554,6 +686,7 @@ private:
   // pointers to our buffered memory
   UpdateBlock* m_polyUpdateBlock = nullptr;
   UpdateBlock* m_highRamUpdateBlock = nullptr;
+  UpdateBlockStats m_updateBlockStats = {};
 };
 
 
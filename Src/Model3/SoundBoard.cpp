@@ -59,6 +59,7 @@
 #include "Supermodel.h"
 #include "OSD/Audio.h"
 #include "Sound/SCSP.h"
+#include <zlib.h>
 
 // DEBUG
 //#define SUPERMODEL_LOG_AUDIO	// define this to log all audio to sound.bin
@@ -86,7 +87,7 @@ static FILE		*soundFP;
 void CSoundBoard::UpdateROMBanks(void)
 {
 	if ((ctrlReg&0x10))
-		sampleBank = &sampleROM[0x800000];
+		sampleBank = &sampleROM[sampleHighBank];
 	else
 		sampleBank = &sampleROM[0x000000];
 }
@@ -354,7 +355,7 @@ static INT16 ClampINT16(float x)
 bool CSoundBoard::RunFrame(void)
 {
 	// Run sound board first to generate SCSP audio
-	if (m_config["EmulateSound"].ValueAs<bool>())
+	if (m_emulateSound.Get())
 	{
 		M68KSetContext(&M68K);
 		SCSP_Update();
@@ -369,7 +370,7 @@ bool CSoundBoard::RunFrame(void)
 	}
 
 	// Compute sound volume as 
-	float soundVol = (float)std::max(0,std::min(200,m_config["SoundVolume"].ValueAs<int>()));
+	float soundVol = (float)std::max(0,std::min(200,m_soundVolume.Get()));
 	soundVol = soundVol * (float)(1.0 / 100.0);
 
 	// Apply sound volume setting to SCSP channels only
@@ -392,7 +393,7 @@ bool CSoundBoard::RunFrame(void)
 	}
 
 	// Output the audio buffers
-	bool bufferFull = OutputAudio(NUM_SAMPLES_PER_FRAME, audioFL, audioFR, audioRL, audioRR, m_config["FlipStereo"].ValueAs<bool>());
+	bool bufferFull = OutputAudio(NUM_SAMPLES_PER_FRAME, audioFL, audioFR, audioRL, audioRR, m_flipStereo.Get());
 
 #ifdef SUPERMODEL_LOG_AUDIO
 	// Output to binary file
@@ -469,6 +470,12 @@ void CSoundBoard::LoadState(CBlockFile *SaveState)
 		DSB->LoadState(SaveState);
 }
 
+UINT32 CSoundBoard::HashMemory(void) const
+{
+	uLong crc = crc32(0, ram1, 0x100000);
+	return UINT32(crc32(crc, ram2, 0x100000));
+}
+
 
 /******************************************************************************
  Configuration, Initialization, and Shutdown
@@ -481,6 +488,12 @@ void CSoundBoard::AttachDSB(CDSB *DSBPtr)
 }
 
 
+void CSoundBoard::SetSampleROMSize(size_t size)
+{
+	sampleHighBank = (size <= 0x800000) ? 0 : 0x800000;
+	UpdateROMBanks();
+}
+
 Result CSoundBoard::Init(const UINT8 *soundROMPtr, const UINT8 *sampleROMPtr)
 {
 	float	memSizeMB = (float)MEMORY_POOL_SIZE/(float)0x100000;
@@ -541,7 +554,10 @@ CDSB *CSoundBoard::GetDSB(void)
 }
 
 CSoundBoard::CSoundBoard(const Util::Config::Node &config)
-  : m_config(config)
+  : m_config(config),
+    m_emulateSound(config.Get("EmulateSound")),
+    m_soundVolume(config.Get("SoundVolume"), 100),
+    m_flipStereo(config.Get("FlipStereo"))
 {
 	DSB = NULL;
 	memoryPool = NULL;
@@ -555,6 +571,7 @@ CSoundBoard::CSoundBoard(const Util::Config::Node &config)
 	sampleROM = NULL;
 
 	sampleBank = nullptr;
+	sampleHighBank = 0x800000;
 	ctrlReg = 0;
 
 	DebugLog("Built Sound Board\n");
@@ -104,6 +104,14 @@ public:
 	 */
 	void LoadState(CBlockFile *SaveState);
 
+	/*
+	 * HashMemory(void):
+	 *
+	 * Returns:
+	 *		CRC-32 of both 68K/SCSP RAM banks, for comparing emulator runs.
+	 */
+	UINT32 HashMemory(void) const;
+
 	/*
 	 * RunFrame(void):
 	 *
@@ -165,6 +173,18 @@ public:
 	 */
 	Result Init(const UINT8 *soundROMPtr, const UINT8 *sampleROMPtr);
 
+	/*
+	 * SetSampleROMSize(size):
+	 *
+	 * Informs the sound board of how much sample ROM the game has. Sample
+	 * ROMs of 8 MB or less are mirrored into the high bank by pointing it at
+	 * the low bank, so the high 8 MB of the sample ROM region are never used.
+	 *
+	 * Parameters:
+	 *		size	Size of the sample ROM in bytes.
+	 */
+	void SetSampleROMSize(size_t size);
+
 	/*
 	 * CSoundBoard(config):
 	 * ~CSoundBoard(void):
@@ -184,6 +204,11 @@ private:
 	
 	// Config
 	const Util::Config::Node &m_config;
+	// Settings read every frame on the sound thread, kept up to date by
+	// config observers
+	Util::Config::Observed<bool>	m_emulateSound;
+	Util::Config::Observed<int>		m_soundVolume;
+	Util::Config::Observed<bool>	m_flipStereo;
 
 	// Digital Sound Board
 	CDSB		*DSB;
@@ -195,6 +220,7 @@ private:
 	const UINT8	*soundROM;		// 68K program ROM (passed in from parent object)
 	const UINT8	*sampleROM;		// 68K sample ROM (passed in from parent object)
 	const UINT8	*sampleBank;	// sample ROM bank switching (points to high or low 8MB)
+	size_t		sampleHighBank;	// offset of high sample ROM bank (0 if mirrored)
 	UINT8		*memoryPool;	// single allocated region for all sound board RAM
 	UINT8		*ram1, *ram2;	// SCSP1 and SCSP2 RAM
 	
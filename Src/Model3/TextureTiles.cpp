@@ -0,0 +1,188 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2011 Bart Trzynadlowski, Nik Henson 
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free 
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+ 
+/*
+ * TextureTiles.cpp
+ * 
+ * Texture tile decoding for the Real3D.
+ *
+ * A tile of 16-bit texels is stored as 2x2 blocks, each holding the two
+ * texels of one row followed by the two texels of the row below, and each
+ * pair in reverse order. Pairs of rows are therefore built from alternate
+ * 32-bit words of the tile with their halves swapped.
+ *
+ * 8-bit tiles work the same way on 16-bit words, high byte first, except
+ * that the rows of each pair are swapped.
+ *
+ * The vector versions only need SSE2, which every x86-64 CPU has, and
+ * handle one pair of rows of an 8 texel wide tile at a time.
+ */
+
+#include "TextureTiles.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_TILES_SSE2
+#endif
+
+namespace TextureTiles
+{
+
+  // Tables of texel offsets corresponding to an NxN texel texture tile
+
+  static constexpr unsigned decode8x8[64] =
+  {
+     1, 0, 5, 4, 9, 8,13,12,
+     3, 2, 7, 6,11,10,15,14,
+    17,16,21,20,25,24,29,28,
+    19,18,23,22,27,26,31,30,
+    33,32,37,36,41,40,45,44,
+    35,34,39,38,43,42,47,46,
+    49,48,53,52,57,56,61,60,
+    51,50,55,54,59,58,63,62
+  };
+
+  static constexpr unsigned decode8x4[32] =
+  {
+     1, 0, 5, 4,
+     3, 2, 7, 6,
+     9, 8,13,12,
+    11,10,15,14,
+    17,16,21,20,
+    19,18,23,22,
+    25,24,29,28,
+    27,26,31,30
+  };
+
+  static constexpr unsigned decode8x2[16] =
+  {
+     1, 0,
+     3, 2,
+     5, 4,
+     7, 6,
+     9, 8,
+    11, 10,
+    13, 12,
+    15, 14
+  };
+
+  static const unsigned *GetDecodeTable(unsigned tileX)
+  {
+    return (tileX == 8) ? decode8x8 : (tileX == 4) ? decode8x4 : (tileX == 2) ? decode8x2 : nullptr;
+  }
+
+  void Store16Scalar(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY)
+  {
+    const unsigned *decode = GetDecodeTable(tileX);
+    if (!decode)
+      return;
+    for (unsigned yy = 0; yy < tileY; yy++)
+    {
+      for (unsigned xx = 0; xx < tileX; xx++)
+        dest[xx] = src[decode[yy * tileX + xx]];
+      dest += pitch;  // next line
+    }
+  }
+
+  void Store8Scalar(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY, uint16_t keepMask)
+  {
+    const unsigned *decode = GetDecodeTable(tileX);
+    if (!decode)
+      return;
+    for (unsigned yy = 0; yy < tileY; yy++)
+    {
+      for (unsigned xx = 0; xx < tileX; xx++)
+      {
+        const unsigned shift = 8 * ((xx & 1) ^ 1);
+        const unsigned index = (yy ^ 1) * tileX + (xx ^ 1) - (tileX & 1);
+        uint16_t texel = (src[decode[index] / 2] >> shift) & 0xFF;
+        texel |= texel << 8;
+        dest[xx] = (dest[xx] & keepMask) | (texel & ~keepMask);
+      }
+      dest += pitch;  // next line
+    }
+  }
+
+#ifdef TEXTURE_TILES_SSE2
+
+  void Store16(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY)
+  {
+    if (tileX != 8 || (tileY & 1))
+    {
+      Store16Scalar(dest, pitch, src, tileX, tileY);
+      return;
+    }
+    for (unsigned yy = 0; yy < tileY; yy += 2)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *) &src[yy * 8 + 0]);
+      __m128i b = _mm_loadu_si128((const __m128i *) &src[yy * 8 + 8]);
+      // Swap texels within each pair, then take even pairs for the first row and odd pairs for the second
+      a = _mm_or_si128(_mm_slli_epi32(a, 16), _mm_srli_epi32(a, 16));
+      b = _mm_or_si128(_mm_slli_epi32(b, 16), _mm_srli_epi32(b, 16));
+      a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+      b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128((__m128i *) dest, _mm_unpacklo_epi64(a, b));
+      _mm_storeu_si128((__m128i *) (dest + pitch), _mm_unpackhi_epi64(a, b));
+      dest += 2 * pitch;
+    }
+  }
+
+  void Store8(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY, uint16_t keepMask)
+  {
+    if (tileX != 8 || (tileY & 1))
+    {
+      Store8Scalar(dest, pitch, src, tileX, tileY, keepMask);
+      return;
+    }
+    const __m128i keep = _mm_set1_epi16(int16_t(keepMask));
+    for (unsigned yy = 0; yy < tileY; yy += 2)
+    {
+      __m128i v = _mm_loadu_si128((const __m128i *) &src[yy * 4]);
+      // High byte first, then split even and odd words (sign extended so that they pack without saturating)
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      __m128i even = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+      __m128i odd = _mm_srai_epi32(v, 16);
+      __m128i texels = _mm_packs_epi32(even, odd);
+      // Odd words make up the first row, even words the second; each texel fills both bytes
+      __m128i row0 = _mm_unpackhi_epi8(texels, texels);
+      __m128i row1 = _mm_unpacklo_epi8(texels, texels);
+      __m128i *dest0 = (__m128i *) dest;
+      __m128i *dest1 = (__m128i *) (dest + pitch);
+      _mm_storeu_si128(dest0, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dest0), keep), _mm_andnot_si128(keep, row0)));
+      _mm_storeu_si128(dest1, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dest1), keep), _mm_andnot_si128(keep, row1)));
+      dest += 2 * pitch;
+    }
+  }
+
+#else
+
+  void Store16(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY)
+  {
+    Store16Scalar(dest, pitch, src, tileX, tileY);
+  }
+
+  void Store8(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY, uint16_t keepMask)
+  {
+    Store8Scalar(dest, pitch, src, tileX, tileY, keepMask);
+  }
+
+#endif  // TEXTURE_TILES_SSE2
+
+}  // TextureTiles
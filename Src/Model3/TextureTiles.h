@@ -0,0 +1,78 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2011 Bart Trzynadlowski, Nik Henson 
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free 
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+ 
+/*
+ * TextureTiles.h
+ * 
+ * Decoding of the swizzled texture tiles that are uploaded to the Real3D
+ * texture RAM.
+ */
+
+#ifndef INCLUDED_TEXTURETILES_H
+#define INCLUDED_TEXTURETILES_H
+
+#include <cstdint>
+
+namespace TextureTiles
+{
+  /*
+   * Store16(dest, pitch, src, tileX, tileY):
+   *
+   * Decodes a tile of 16-bit texels into texture RAM.
+   *
+   * Parameters:
+   *    dest    Top-left texel of the tile in texture RAM.
+   *    pitch   Distance between texture RAM rows, in texels.
+   *    src     Tile data (tileX*tileY texels).
+   *    tileX   Tile width: 8, 4, or 2.
+   *    tileY   Tile height: 1 to 8.
+   */
+  void Store16(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY);
+
+  /*
+   * Store8(dest, pitch, src, tileX, tileY, keepMask):
+   *
+   * Decodes a tile of 8-bit texels into texture RAM. Each texel is repeated
+   * in both bytes of a texture RAM word and merged into it, preserving the
+   * bits set in keepMask.
+   *
+   * Parameters:
+   *    dest      Top-left texel of the tile in texture RAM.
+   *    pitch     Distance between texture RAM rows, in texels.
+   *    src       Tile data (tileX*tileY texels, two per word).
+   *    tileX     Tile width: 8, 4, or 2.
+   *    tileY     Tile height: 1 to 8.
+   *    keepMask  Bits of texture RAM to leave unchanged.
+   */
+  void Store8(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY, uint16_t keepMask);
+
+  /*
+   * Store16Scalar(), Store8Scalar():
+   *
+   * Reference versions of the above that decode one texel at a time through
+   * lookup tables. Store16() and Store8() use vector instructions for full
+   * width tiles when available and must give identical results.
+   */
+  void Store16Scalar(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY);
+  void Store8Scalar(uint16_t *dest, unsigned pitch, const uint16_t *src, unsigned tileX, unsigned tileY, uint16_t keepMask);
+}
+
+#endif  // INCLUDED_TEXTURETILES_H
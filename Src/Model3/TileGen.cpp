@@ -110,6 +110,42 @@ void CTileGen::LoadState(CBlockFile *SaveState)
 	SyncSnapshots();
 }
 
+void CTileGen::RestoreState(CBlockFile *SaveState)
+{
+	if (Result::OKAY != SaveState->FindBlock("Tile Generator"))
+	{
+		ErrorLog("Unable to load tile generator state. Save state file is corrupt.");
+		return;
+	}
+
+	// Only write the words that differ, so only changed palette entries are converted
+	for (int i = 0; i < 0x120000; i += 0x1000)
+	{
+		UINT32 data[0x1000 / 4];
+		SaveState->Read(data, sizeof(data));
+		if (!memcmp(&m_vram[i], data, sizeof(data)))
+			continue;
+		for (int j = 0; j < 0x1000 / 4; j++) {
+			if (ReadRAM32(i + j * 4) != data[j])
+				WriteRAM32(i + j * 4, data[j]);
+		}
+	}
+
+	UINT32 colourOffsets[2] = { m_regs[0x40 / 4], m_regs[0x44 / 4] };
+	SaveState->Read(m_regs, sizeof(m_regs));
+
+	if (m_regs[0x40 / 4] != colourOffsets[0]) {
+		m_colourOffsetRegs[0].Update(m_regs[0x40 / 4]);
+		RecomputePalettes(0);	// layer 0 & 1
+	}
+	if (m_regs[0x44 / 4] != colourOffsets[1]) {
+		m_colourOffsetRegs[1].Update(m_regs[0x44 / 4]);
+		RecomputePalettes(1);	// layer 2 & 3
+	}
+
+	// The draw surfaces are redrawn by the next frame before they are shown
+}
+
 
 /******************************************************************************
  Rendering
@@ -148,7 +184,8 @@ UINT32 CTileGen::SyncSnapshots(void)
 		std::swap(m_drawSurface[i], m_drawSurfaceRO[i]);
 	}
 
-	Render2D->AttachDrawBuffers(m_drawSurfaceRO[0], m_drawSurfaceRO[1]);
+	if (Render2D)
+		Render2D->AttachDrawBuffers(m_drawSurfaceRO[0], m_drawSurfaceRO[1]);
 	
 	return UINT32(0);
 }
@@ -300,6 +337,8 @@ void CTileGen::Reset(void)
 void CTileGen::AttachRenderer(CRender2D *Render2DPtr)
 {
 	Render2D = Render2DPtr;
+	if (!Render2D)	// running headless
+		return;
 
 	Render2D->AttachVRAM(m_vram);
 	Render2D->AttachRegisters(m_regs);
@@ -61,6 +61,19 @@ public:
 	 */
 	void LoadState(CBlockFile* SaveState);
 
+	/*
+	 * RestoreState(SaveState):
+	 *
+	 * Loads a state image saved from the running machine a few frames
+	 * earlier, only updating what differs. Unlike LoadState(), the layers
+	 * are not redrawn, so the surfaces being displayed are left as they are
+	 * until the next frame is emulated.
+	 *
+	 * Parameters:
+	 *		SaveState	Block file to load state information from.
+	 */
+	void RestoreState(CBlockFile* SaveState);
+
 	/*
 	 * BeginVBlank(void):
 	 *
@@ -220,7 +233,9 @@ public:
 	 * work with.
 	 *
 	 * Parameters:
-	 *		Render2DPtr		Pointer to a 2D renderer object.
+	 *		Render2DPtr		Pointer to a 2D renderer object. May be NULL when
+	 *						running headless, in which case frames must not
+	 *						be rendered.
 	 */
 	void AttachRenderer(CRender2D* Render2DPtr);
 
@@ -37,6 +37,17 @@ typedef void (*AudioCallbackFPtr)(void *data);
 extern void SetAudioCallback(AudioCallbackFPtr callback, void *data);
 
 extern void SetAudioEnabled(bool enabled);
+
+/*
+ * SetAudioDiscard(bool discard)
+ * GetAudioDiscard()
+ *
+ * While set, OutputAudio() drops everything it is given without touching the
+ * playback buffer. Used for frames whose output must never be heard
+ * (run-ahead) or would play back garbled (fast-forward).
+ */
+extern void SetAudioDiscard(bool discard);
+extern bool GetAudioDiscard();
 extern void SetAudioType(Game::AudioTypes type);
 
 /*
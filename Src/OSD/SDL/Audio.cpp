@@ -60,6 +60,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 
   // Model3 audio output is 44.1KHz 4-channel sound and frame rate is 60fps
 #define SAMPLE_RATE_M3     (44100)
@@ -95,6 +96,7 @@ float balanceFactorRearLeft   = 1.0f;
 float balanceFactorRearRight  = 1.0f;
 
 static bool enabled = true;         // True if sound output is enabled
+static std::atomic<bool> discardOutput(false);  // True if OutputAudio() should drop all samples (run-ahead frames)
 static constexpr unsigned latency = 20;       // Audio latency to use (ie size of audio buffer) as percentage of max buffer size
 static constexpr bool underRunLoop = true;    // True if should loop back to beginning of buffer on under-run, otherwise sound is just skipped
 
@@ -133,6 +135,16 @@ void SetAudioEnabled(bool newEnabled)
     enabled = newEnabled;
 }
 
+void SetAudioDiscard(bool discard)
+{
+    discardOutput.store(discard, std::memory_order_relaxed);
+}
+
+bool GetAudioDiscard()
+{
+    return discardOutput.load(std::memory_order_relaxed);
+}
+
 /// <summary>
 /// Set game audio mixing type
 /// </summary>
@@ -542,6 +554,11 @@ bool OutputAudio(unsigned numSamples, const float* leftFrontBuffer, const float*
     UINT32 bytesToCopy;
     INT16* src;
 
+    // Discarded frames must not consume buffer space. Report the buffer as
+    // full so that an unsynced sound board thread doesn't spin trying to fill it
+    if (discardOutput.load(std::memory_order_relaxed))
+        return true;
+
     // Number of samples should never be more than max number of samples per frame
     if (numSamples > (unsigned)samples_per_frame_host)
         numSamples = samples_per_frame_host;
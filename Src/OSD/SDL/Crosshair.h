@@ -30,6 +30,7 @@ class CCrosshair
 {
 private:
   const Util::Config::Node& m_config;
+  Util::Config::Observed<unsigned> m_crosshairs;  // which players (toggled by a hotkey)
   bool m_isBitmapCrosshair = false;
   std::string m_crosshairStyle;
   GLuint m_crosshairTexId[2] = { 0 };
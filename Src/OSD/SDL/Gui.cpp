@@ -17,6 +17,7 @@
 #include "Util/ConfigBuilders.h"
 #include "../Src/OSD/SDL/SDLInputSystem.h"
 #include "../Src/Inputs/Inputs.h"
+#include "../Src/Inputs/ReplayPlayer.h"
 #include "Main.h"
 #include "Font01.h"
 #include <ctime>   // time, localtime, strftime 用
@@ -282,7 +283,7 @@ void GUI(ImGuiIO &io, Util::Config::Node &config,
          bool &vBorderless, bool &vTrueAR, bool &vOverlay, bool &vFullScreen, bool &vWideScreen,
          bool &vWideBackground, bool &vStretch, bool &vShowFrameRate, bool &vThrottle,
          bool &vNoWhiteFlash, bool &vHideCMD, bool &vDefaultScanline, bool &vTrueHz, int &superSampling, int &selectedCRT, int &selectedUpscale,
-         int &ppcFreq, int &WindowXPosition, int &WindowYPosition, int &Scanline, int &Barrel,
+         int &ppcFreq, int &runAheadFrames, int &WindowXPosition, int &WindowYPosition, int &Scanline, int &Barrel,
          int &musicVol, int &sfxVol, int &balance, bool &vEmulateSound,
          bool &vEmulateDSB, bool &vFlipStereo, bool &vLegacySoundDSP,
          int &selectedInputType, int &selectedCrosshair, int &selectedStyle,
@@ -822,6 +823,15 @@ void GUI(ImGuiIO &io, Util::Config::Node &config,
                         saveSettings = true;
                     }
                     ImGui::PopItemWidth();
+                    // 入力遅延を隠すための先行フレーム数（0で無効）
+                    ImGui::Text("Run-Ahead Frames");
+                    ImGui::SameLine(150.0f * scale);
+                    ImGui::PushItemWidth(-1);
+                    if (ImGui::SliderInt("##RunAhead", &runAheadFrames, 0, 4))
+                    {
+                        saveSettings = true;
+                    }
+                    ImGui::PopItemWidth();
                     // static int Scanline = 1;
                     ImGui::Text("Scanline Strength");
                     ImGui::SameLine(150.0f * scale);
@@ -1087,7 +1097,7 @@ void GUI(ImGuiIO &io, Util::Config::Node &config,
                     ImGui::Spacing();
 
                     // Replay用のChild Windowでひとまとめにする
-                    ImGui::BeginChild("ReplayControl", ImVec2(0, 150 * scale), true); // 少し高さを広げたぜ
+                    ImGui::BeginChild("ReplayControl", ImVec2(0, 200 * scale), true); // シーク用に高さを広げた
                     {
                         ImGui::SetWindowFontScale(scale);
 
@@ -1206,6 +1216,33 @@ void GUI(ImGuiIO &io, Util::Config::Node &config,
                             ImGui::EndPopup();
                         }
 
+                        // 選択中のリプレイの長さとキーフレーム（末尾の索引だけ読むので軽い）
+                        static std::string infoFile;
+                        static bool infoOk = false;
+                        static uint32_t infoLastFrame = 0;
+                        static unsigned infoKeyframes = 0;
+                        static int seekSeconds = 0;
+                        if (replayFilename != infoFile)
+                        {
+                            infoFile = replayFilename;
+                            infoOk = !infoFile.empty() && ReplayPlayer::ReadInfo(infoFile.c_str(), infoLastFrame, infoKeyframes);
+                            seekSeconds = 0;
+                        }
+
+                        float replayHz = vTrueHz ? 57.524158f : 60.0f;
+                        if (infoOk)
+                        {
+                            int lengthSeconds = (int)(infoLastFrame / replayHz);
+                            ImGui::Text("Length: %d:%02d  Keyframes: %u", lengthSeconds / 60, lengthSeconds % 60, infoKeyframes);
+
+                            // 途中から再生（起動時に最寄りのキーフレームを読んで、そこから早送りする）
+                            ImGui::SliderInt("Start At (sec)", &seekSeconds, 0, lengthSeconds);
+                        }
+                        else if (!replayFilename.empty())
+                        {
+                            ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "No keyframe index: plays from the start.");
+                        }
+
                         ImGui::Spacing();
 
                         // 3. アクションボタン
@@ -1297,6 +1334,8 @@ void GUI(ImGuiIO &io, Util::Config::Node &config,
                                     // fullPath が "Replays/xxx.rec" なので、そのままぶち込む！
                                     std::string cmd = "\"" + std::string(szExePath) + "\"";
                                     cmd += " -play \"" + fullPath + "\"";
+                                    if (infoOk && seekSeconds > 0)
+                                        cmd += " -replay-seek=" + std::to_string(seekSeconds);
                                     cmd += " \"" + s_Dir + "/" + romName + ".zip\"";
 
                                     // 4. プロセス起動
@@ -1734,6 +1773,7 @@ std::vector<std::string> RunGUI(const std::string &configPath, Util::Config::Nod
     int selectedCRT = (int)config["CRTcolors"].ValueAs<int64_t>();
     int selectedUpscale = (int)config["UpscaleMode"].ValueAs<int64_t>();
     int ppcFreq = (int)config["PowerPCFrequency"].ValueAs<int64_t>();
+    int runAheadFrames = (int)config["RunAheadFrames"].ValueAs<int64_t>();
     int WindowXPosition = (int)config["WindowXPosition"].ValueAs<int64_t>();
     int WindowYPosition = (int)config["WindowYPosition"].ValueAs<int64_t>();
     int Scanline = (int)config["ScanlineStrength"].ValueAs<int64_t>();
@@ -1777,7 +1817,7 @@ std::vector<std::string> RunGUI(const std::string &configPath, Util::Config::Nod
         bool vVsync, vQuadRendering, vGPUMultiThreaded, vMultiThreaded;
         bool vMultiTexture, vBorderless, vTrueAR, vOverlay, vFullScreen, vWideScreen;
         bool vWideBackground, vStretch, vShowFrameRate, vThrottle, vNoWhiteFlash, vHideCMD, vDefaultScanline, vTrueHz;
-        int superSampling, selectedCRT, selectedUpscale, ppcFreq;
+        int superSampling, selectedCRT, selectedUpscale, ppcFreq, runAheadFrames;
         int WindowXPosition, WindowYPosition, Scanline, Barrel;
         int musicVol, sfxVol, balance;
         bool vEmulateSound, vEmulateDSB, vFlipStereo, vLegacySoundDSP;
@@ -1934,7 +1974,7 @@ std::vector<std::string> RunGUI(const std::string &configPath, Util::Config::Nod
             selectedResIndex, engineSelection, vVsync, vQuadRendering, vGPUMultiThreaded,
             vMultiThreaded, vMultiTexture, vBorderless, vTrueAR, vOverlay, vFullScreen,
             vWideScreen, vWideBackground, vStretch, vShowFrameRate, vThrottle,
-            vNoWhiteFlash, vHideCMD, vDefaultScanline, vTrueHz, superSampling, selectedCRT, selectedUpscale, ppcFreq, WindowXPosition, WindowYPosition, Scanline, Barrel,
+            vNoWhiteFlash, vHideCMD, vDefaultScanline, vTrueHz, superSampling, selectedCRT, selectedUpscale, ppcFreq, runAheadFrames, WindowXPosition, WindowYPosition, Scanline, Barrel,
             musicVol, sfxVol, balance, vEmulateSound, vEmulateDSB, vFlipStereo,
             vLegacySoundDSP, selectedInputType, selectedCrosshair, selectedStyle,
             vForceFeedback, vNetwork, vSimulateNet, bufPortIn, bufPortOut, bufAddressOut);
@@ -2028,6 +2068,7 @@ std::vector<std::string> RunGUI(const std::string &configPath, Util::Config::Nod
         u["CRTcolors"] = std::to_string(selectedCRT);
         u["UpscaleMode"] = std::to_string(selectedUpscale);
         u["PowerPCFrequency"] = std::to_string(ppcFreq);
+        u["RunAheadFrames"] = std::to_string(runAheadFrames);
         u["ScanlineStrength"] = std::to_string(Scanline);
         u["BarrelStrength"] = std::to_string(Barrel);
 
@@ -95,6 +95,7 @@
 #include "OSD/Audio.h"
 #include "Graphics/New3D/VBO.h"
 #include "Graphics/SuperAA.h"
+#include "Graphics/NullRender3D.h"
 #include "Sound/MPEG/MpegAudio.h"
 
 #include <iostream>
@@ -105,6 +106,7 @@
 #include "Gui.h"
 #include "Inputs/ReplayRecorder.h"
 #include "Inputs/ReplayPlayer.h"
+#include "RewindBuffer.h"
 #include <cstdlib>
 #include <chrono>
 #include <ctime>
@@ -147,6 +149,7 @@ int BarrelStrength = 1;
 bool replayRequested = false;
 bool replayStarted = false;
 std::string replayFile;
+static unsigned replaySeekSeconds = 0; // -replay-seek: start playback this far in
 static bool lastLoadStatePressed = false;
 
 /*
@@ -794,19 +797,24 @@ static void TestPolygonHeaderBits(IEmulator *Emu)
  Data: Save state file version (4-byte integer), ROM set ID (up to 9 bytes,
  including terminating \0).
 
+ Save states are written in the indexed block file format, optionally
+ compressed. States in the original format can still be loaded.
+
  Different subsystems output their own blocks.
 ******************************************************************************/
 
 static const int STATE_FILE_VERSION = 5; // save state file version
 static const int NVRAM_FILE_VERSION = 0; // NVRAM file version
 static unsigned s_saveSlot = 0;          // save state slot #
+static CRewindBuffer s_rewindBuffer;     // in-memory snapshots for rewinding
 
 static void SaveState(IEmulator *Model3)
 {
   CBlockFile SaveState;
 
   std::string file_path = Util::Format() << FileSystemPath::GetPath(FileSystemPath::Saves) << Model3->GetGame().name << ".st" << s_saveSlot;
-  if (Result::OKAY != SaveState.Create(file_path, "Supermodel Save State", "Supermodel Version " SUPERMODEL_VERSION))
+  bool compress = s_runtime_config["CompressSaveStates"].ValueAs<bool>();
+  if (Result::OKAY != SaveState.CreateIndexed(file_path, "Supermodel Save State", "Supermodel Version " SUPERMODEL_VERSION, compress))
   {
     ErrorLog("Unable to save state to '%s'.", file_path.c_str());
     return;
@@ -819,7 +827,11 @@ static void SaveState(IEmulator *Model3)
 
   // Save state
   Model3->SaveState(&SaveState);
-  SaveState.Close();
+  if (Result::OKAY != SaveState.Close())
+  {
+    ErrorLog("Unable to save state to '%s'.", file_path.c_str());
+    return;
+  }
   printf("Saved state to '%s'.\n", file_path.c_str());
   InfoLog("Saved state to '%s'.", file_path.c_str());
 }
@@ -856,6 +868,7 @@ static void LoadState(IEmulator *Model3, std::string file_path = std::string())
   // Load
   Model3->LoadState(&SaveState);
   SaveState.Close();
+  s_rewindBuffer.Clear();
   printf("Loaded state from '%s'.\n", file_path.c_str());
   InfoLog("Loaded state from '%s'.", file_path.c_str());
 }
@@ -940,14 +953,18 @@ static void PrintGLError(GLenum error)
 
 static CInputs *videoInputs = NULL;
 static uint32_t currentInputs = 0;
+static bool s_suppressVideo = false;  // frames not to be shown (run-ahead)
 
 bool BeginFrameVideo()
 {
-  return true;
+  return !s_suppressVideo;
 }
 
 void EndFrameVideo()
 {
+  if (s_suppressVideo)
+    return;
+
   // Show crosshairs for light gun games
   if (videoInputs)
     s_crosshair->Update(currentInputs, videoInputs, xOffset, yOffset, xRes, yRes);
@@ -1003,6 +1020,135 @@ static void SuperSleepUntil(const uint64_t target)
   } while (remain > 0);
 }
 
+/******************************************************************************
+ Run-Ahead
+
+ Hides the game's own input lag. Each host frame, the real frame is emulated
+ without being shown, the machine state is saved to memory, and a number of
+ extra frames are emulated with the same inputs. The last of these is shown
+ and the state is then restored, so the speculative frames never affect the
+ real timeline. Their audio is discarded.
+
+ The state is an ordinary save state written to a reused memory buffer. It is
+ restored with RestoreState(), which only rewrites the memory and re-uploads
+ the textures that the speculative frames changed.
+******************************************************************************/
+
+static std::vector<uint8_t> s_runAheadState;  // state of the real frame
+
+static struct
+{
+  uint64_t  saveTicks = 0;    // performance counter ticks spent saving state
+  uint64_t  runTicks = 0;     // ... emulating speculative frames
+  uint64_t  loadTicks = 0;    // ... restoring state
+  unsigned  frames = 0;       // host frames measured
+} s_runAheadTimings;
+
+static void RunFrameAhead(IEmulator *Model3, unsigned numFrames)
+{
+  // Real frame
+  s_suppressVideo = true;
+  Model3->RunFrame();
+
+  uint64_t t0 = SDL_GetPerformanceCounter();
+  Model3->PauseThreads();
+  CBlockFile state;
+  state.Create(&s_runAheadState, "Supermodel Run-Ahead State", "Supermodel Version " SUPERMODEL_VERSION);
+  Model3->SaveState(&state);
+  state.Close();
+  Model3->ResumeThreads();
+
+  // Speculative frames. The last one is rendered explicitly once the threads
+  // are paused, which works whether or not the GPU is on its own thread (in
+  // which case RunFrame() draws the previous frame).
+  uint64_t t1 = SDL_GetPerformanceCounter();
+  SetAudioDiscard(true);
+  for (unsigned i = 0; i < numFrames; i++)
+    Model3->RunFrame();
+  Model3->PauseThreads();
+  s_suppressVideo = false;
+  Model3->RenderFrame();
+
+  uint64_t t2 = SDL_GetPerformanceCounter();
+  state.Load(s_runAheadState.data(), s_runAheadState.size());
+  Model3->RestoreState(&state);
+  state.Close();
+  Model3->ResumeThreads();
+  SetAudioDiscard(false);
+  uint64_t t3 = SDL_GetPerformanceCounter();
+
+  s_runAheadTimings.saveTicks += t1 - t0;
+  s_runAheadTimings.runTicks += t2 - t1;
+  s_runAheadTimings.loadTicks += t3 - t2;
+  s_runAheadTimings.frames += 1;
+}
+
+/******************************************************************************
+ Replay Keyframes
+
+ While recording, a save state is embedded in the replay file every
+ ReplayKeyframeInterval seconds. Playback can then seek by loading the
+ nearest keyframe at or before the target and emulating the remaining frames
+ without video or sound, instead of re-simulating from the start.
+******************************************************************************/
+
+static std::vector<uint8_t> s_keyframeState;  // reused save state buffer
+
+static uint32_t SecondsToFrames(unsigned seconds)
+{
+  return uint32_t(uint64_t(seconds) * GetDesiredRefreshRateMilliHz() / 1000);
+}
+
+static void CaptureReplayKeyframe(IEmulator *Model3)
+{
+  Model3->PauseThreads();
+  CBlockFile state;
+  state.Create(&s_keyframeState, "Supermodel Replay Keyframe", "Supermodel Version " SUPERMODEL_VERSION);
+  Model3->SaveState(&state);
+  state.Close();
+  Model3->ResumeThreads();
+  ReplayRecorder::AddKeyframe(s_keyframeState);
+}
+
+static void SeekReplay(const Game &game, IEmulator *Model3, CInputs *Inputs, uint32_t targetFrame)
+{
+  // Only load a keyframe if it is closer than where we already are
+  uint32_t current = ReplayPlayer::GetFrame();
+  uint32_t keyframeFrame;
+  if (ReplayPlayer::FindKeyframe(targetFrame, keyframeFrame) && (keyframeFrame >= current || targetFrame < current) &&
+      ReplayPlayer::LoadKeyframe(keyframeFrame, s_keyframeState))
+  {
+    Model3->PauseThreads();
+    CBlockFile state;
+    state.Load(s_keyframeState.data(), s_keyframeState.size());
+    Model3->LoadState(&state);
+    state.Close();
+    Model3->ResumeThreads();
+    ReplayPlayer::Seek(keyframeFrame);
+  }
+  else if (targetFrame < current)
+  {
+    ErrorLog("Cannot seek replay back to frame %u: no keyframe before it.", targetFrame);
+    return;
+  }
+  s_rewindBuffer.Clear();
+
+  // Emulate the rest of the way, discarding video and sound
+  bool suppressVideo = s_suppressVideo;
+  bool discardAudio = GetAudioDiscard();
+  s_suppressVideo = true;
+  SetAudioDiscard(true);
+  while (ReplayPlayer::IsPlaying() && ReplayPlayer::GetFrame() <= targetFrame)
+  {
+    if (!Inputs->Poll(&game, xOffset, yOffset, xRes, yRes))
+      break;
+    Model3->RunFrame();
+  }
+  s_suppressVideo = suppressVideo;
+  SetAudioDiscard(discardAudio);
+  InfoLog("Replay seek: now at frame %u.", ReplayPlayer::GetFrame());
+}
+
 /******************************************************************************
  Main Program Loop
 ******************************************************************************/
@@ -1021,11 +1167,16 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
   bool gameHasLightguns = false;
   bool quit = false;
   bool paused = false;
+  bool rewinding = false;
+  bool fastForwarding = false;
+  unsigned fastForwardCount = 0;
   bool dumpTimings = false;
+  unsigned runAheadFrames = s_runtime_config["RunAheadFrames"].ValueAs<unsigned>();
+  unsigned fastForwardInterval = s_runtime_config["FastForwardInterval"].ValueAs<unsigned>();
+  Util::Config::Handle<bool> throttle(s_runtime_config, "Throttle");
+  Util::Config::Handle<bool> showFrameRate(s_runtime_config, "ShowFrameRate");
 
-  // Initialize and load ROMs
-  if (Result::OKAY != Model3->Init())
-    return 1;
+  // Load ROMs (emulator was initialized by caller)
   if (Model3->LoadGame(game, *rom_set) != Result::OKAY)
     return 1;
   *rom_set = ROMSet(); // free up this memory we won't need anymore
@@ -1129,6 +1280,9 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
   if (!initialState.empty())
     LoadState(Model3, initialState);
 
+  // Rewind buffer (size is in MB, 0 disables it)
+  s_rewindBuffer.Configure(size_t(s_runtime_config["RewindBufferSize"].ValueAs<unsigned>()) << 20, s_runtime_config["RewindInterval"].ValueAs<unsigned>());
+
 #ifdef SUPERMODEL_DEBUGGER
   // If debugger was supplied, set it as logger and attach it to system
   oldLogger = GetLogger();
@@ -1158,16 +1312,77 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
     bool currentLoadStatePressed = Inputs->uiLoadState->Pressed();
     if (replayRequested && !replayStarted)
     {
-      ReplayPlayer::Start(replayFile.c_str());
+      if (ReplayPlayer::Start(replayFile.c_str(), Inputs) && replaySeekSeconds)
+        SeekReplay(game, Model3, Inputs, SecondsToFrames(replaySeekSeconds));
       replayStarted = true;
     }
 
     Inputs->Poll(&game, xOffset, yOffset, xRes, yRes);
+
+    // Rewind is held: threads stay paused and one snapshot is restored and
+    // displayed per frame until released
+    bool rewindHeld = !paused && s_rewindBuffer.NumSnapshots() > 0 && Inputs->uiRewind->value != 0;
+    if (rewindHeld != rewinding)
+    {
+      rewinding = rewindHeld;
+      if (rewinding)
+      {
+        SetAudioEnabled(false);
+        snprintf(titleStr, sizeof(titleStr), "%s (Rewinding)", baseTitleStr);
+        SDL_SetWindowTitle(s_window, titleStr);
+      }
+      else if (!paused)
+      {
+        Model3->ResumeThreads();
+        SetAudioEnabled(true);
+        SDL_SetWindowTitle(s_window, baseTitleStr);
+      }
+    }
+
+    // Fast-forward is held: emulate flat out with sound discarded, only showing
+    // every Nth frame. Skipped frames still sync the GPUs, just don't draw.
+    bool fastForwardHeld = !paused && !rewinding && Inputs->uiFastForward->value != 0;
+    if (fastForwardHeld != fastForwarding)
+    {
+      fastForwarding = fastForwardHeld;
+      fastForwardCount = 0;
+      SetAudioDiscard(fastForwarding);
+      if (fastForwarding)
+        snprintf(titleStr, sizeof(titleStr), "%s (Fast-Forward)", baseTitleStr);
+      SDL_SetWindowTitle(s_window, fastForwarding ? titleStr : baseTitleStr);
+    }
+
     // Render if paused, otherwise run a frame
     if (paused)
       Model3->RenderFrame();
+    else if (rewinding)
+    {
+      Model3->PauseThreads(); // no-op unless a UI action below resumed them
+      s_rewindBuffer.Rewind(Model3);
+      Model3->RenderFrame();
+    }
     else
-      Model3->RunFrame();
+    {
+      if (fastForwarding)
+      {
+        fastForwardCount = (fastForwardCount + 1) % fastForwardInterval;
+        s_suppressVideo = fastForwardCount != 0;
+        Model3->RunFrame();
+        s_suppressVideo = false;
+      }
+      else if (runAheadFrames)
+        RunFrameAhead(Model3, runAheadFrames);
+      else
+        Model3->RunFrame();
+      if (s_rewindBuffer.Tick())
+      {
+        Model3->PauseThreads();
+        s_rewindBuffer.Capture(Model3);
+        Model3->ResumeThreads();
+      }
+      if (ReplayRecorder::KeyframeDue())
+        CaptureReplayKeyframe(Model3);
+    }
 
 #ifdef SUPERMODEL_DEBUGGER
     bool processUI = true;
@@ -1257,6 +1472,7 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
 
         // Reset emulator
         Model3->Reset();
+        s_rewindBuffer.Clear();
 
 #ifdef SUPERMODEL_DEBUGGER
         // If debugger was supplied, reset it too
@@ -1466,8 +1682,8 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
       else if (Inputs->uiToggleFrLimit->Pressed())
       {
         // Toggle frame limiting
-        s_runtime_config.Get("Throttle").SetValue(!s_runtime_config["Throttle"].ValueAs<bool>());
-        printf("Frame limiting: %s\n", s_runtime_config["Throttle"].ValueAs<bool>() ? "On" : "Off");
+        s_runtime_config.Get("Throttle").SetValue(!throttle.Get());
+        printf("Frame limiting: %s\n", throttle.Get() ? "On" : "Off");
       }
       else if (Inputs->uiScreenshot->Pressed())
       {
@@ -1484,7 +1700,7 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
 #endif // SUPERMODEL_DEBUGGER
     lastLoadStatePressed = currentLoadStatePressed;
     // Refresh rate (frame limiting)
-    if (paused || s_runtime_config["Throttle"].ValueAs<bool>())
+    if (paused || (throttle.Get() && !fastForwarding))
     {
       SuperSleepUntil(nextTime);
       nextTime = SDL_GetPerformanceCounter() + perfCountPerFrame;
@@ -1492,14 +1708,24 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
 
     // Measure frame rate
     uint64_t currentFPSTicks = SDL_GetPerformanceCounter();
-    if (s_runtime_config["ShowFrameRate"].ValueAs<bool>())
+    if (showFrameRate.Get())
     {
       fpsFramesElapsed += 1;
       uint64_t measurementTicks = currentFPSTicks - prevFPSTicks;
       if (measurementTicks >= s_perfCounterFrequency) // update FPS every 1 second (s_perfCounterFrequency is how many perf ticks in one second)
       {
         double fps = double(fpsFramesElapsed) / (double(measurementTicks) / double(s_perfCounterFrequency));
-        snprintf(titleStr, sizeof(titleStr), "%s - %1.3f FPS%s", baseTitleStr, fps, paused ? " (Paused)" : "");
+        if (runAheadFrames && s_runAheadTimings.frames)
+        {
+          // Average extra cost per host frame of saving, speculating and restoring
+          double msPerTick = 1000.0 / double(s_perfCounterFrequency) / double(s_runAheadTimings.frames);
+          snprintf(titleStr, sizeof(titleStr), "%s - %1.3f FPS - Run-ahead %u: %1.2f+%1.2f+%1.2f ms%s", baseTitleStr, fps, runAheadFrames,
+            double(s_runAheadTimings.saveTicks) * msPerTick, double(s_runAheadTimings.runTicks) * msPerTick, double(s_runAheadTimings.loadTicks) * msPerTick,
+            paused ? " (Paused)" : "");
+          s_runAheadTimings = {};
+        }
+        else
+          snprintf(titleStr, sizeof(titleStr), "%s - %1.3f FPS%s", baseTitleStr, fps, paused ? " (Paused)" : "");
         SDL_SetWindowTitle(s_window, titleStr);
         prevFPSTicks = currentFPSTicks; // reset tick count
         fpsFramesElapsed = 0;           // reset frame count
@@ -1511,6 +1737,20 @@ int Supermodel(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *In
       CModel3 *M = dynamic_cast<CModel3 *>(Model3);
       if (M)
         M->DumpTimings();
+      New3D::CNew3D *R = dynamic_cast<New3D::CNew3D *>(Render3D);
+      if (R)
+      {
+        New3D::CNew3D::DrawListStats draws = R->GetDrawListStats();
+        printf("  new3d meshes:%5u drawn:%5u\n", draws.meshes, draws.drawn);
+      }
+      if (runAheadFrames && s_runAheadTimings.frames)
+      {
+        double msPerTick = 1000.0 / double(s_perfCounterFrequency) / double(s_runAheadTimings.frames);
+        printf("run-ahead:%u save:%6.2fms run:%6.2fms load:%6.2fms\n", runAheadFrames,
+          double(s_runAheadTimings.saveTicks) * msPerTick, double(s_runAheadTimings.runTicks) * msPerTick, double(s_runAheadTimings.loadTicks) * msPerTick);
+        if (!showFrameRate.Get())
+          s_runAheadTimings = {};
+      }
     }
   }
 
@@ -1562,6 +1802,74 @@ QuitError:
   return 1;
 }
 
+/******************************************************************************
+ Headless Replay
+
+ Plays a replay as fast as possible with no window, GL context or sound, for
+ determinism checks and benchmarking. Every HashInterval frames (and at the
+ end), checksums of main RAM, Real3D memory and sound RAM are printed. The
+ output of two runs can be diffed to find the first frame at which they
+ diverge. Emulation is forced single-threaded so that runs are repeatable.
+******************************************************************************/
+
+static void PrintStateHashes(IEmulator *Model3, unsigned frame)
+{
+  CModel3 *M = dynamic_cast<CModel3 *>(Model3);
+  if (!M)
+    return;
+  StateHashes hashes = M->HashState();
+  printf("frame %u: ram=%08X real3d=%08X sndram=%08X\n", frame, hashes.ram, hashes.real3D, hashes.soundRAM);
+}
+
+static int RunHeadlessReplay(const Game &game, ROMSet *rom_set, IEmulator *Model3, CInputs *Inputs, const std::string &replayFile)
+{
+  std::string initialState = s_runtime_config["InitStateFile"].ValueAs<std::string>();
+  unsigned hashInterval = s_runtime_config["HashInterval"].ValueAs<unsigned>();
+
+  if (Model3->LoadGame(game, *rom_set) != Result::OKAY)
+    return 1;
+  *rom_set = ROMSet();
+  LoadNVRAM(Model3);
+
+  // No renderers, no video output, no sound
+  CNullRender3D render3D;
+  Model3->AttachRenderers(nullptr, &render3D, nullptr);
+  Model3->AttachInputs(Inputs);
+  s_suppressVideo = true;
+  SetAudioDiscard(true);
+
+  Model3->Reset();
+  if (!initialState.empty())
+    LoadState(Model3, initialState);
+
+  if (!ReplayPlayer::Start(replayFile.c_str(), Inputs))
+    return 1;
+
+  s_perfCounterFrequency = SDL_GetPerformanceFrequency();
+  uint64_t startTicks = SDL_GetPerformanceCounter();
+  if (replaySeekSeconds)
+    SeekReplay(game, Model3, Inputs, SecondsToFrames(replaySeekSeconds));
+  unsigned frame = ReplayPlayer::GetFrame();
+  while (ReplayPlayer::IsPlaying())
+  {
+    if (!Inputs->Poll(&game, 0, 0, 496, 384))
+      break;
+    Model3->RunFrame();
+    ++frame;
+    if (hashInterval && frame % hashInterval == 0)
+      PrintStateHashes(Model3, frame);
+  }
+  if (!hashInterval || frame % hashInterval != 0)
+    PrintStateHashes(Model3, frame);
+
+  double seconds = double(SDL_GetPerformanceCounter() - startTicks) / double(s_perfCounterFrequency);
+  printf("Emulated %u frames in %1.3f seconds (%1.3f FPS)\n", frame, seconds, seconds > 0 ? double(frame) / seconds : 0.0);
+
+  // NVRAM is deliberately not saved so that runs stay repeatable
+  Model3->PauseThreads();
+  return 0;
+}
+
 /******************************************************************************
  Entry Point and Command Line Processing
 ******************************************************************************/
@@ -1682,6 +1990,7 @@ Util::Config::Node DefaultConfig()
 
   config.Set("GameXMLFile", s_gameXMLFilePath);
   config.Set("InitStateFile", "");
+  config.Set("ROMCacheDir", "");  // directory for decoded ROM images, empty disables the cache
   config.Set("HideCMD", false, "");
   config.Set<std::string>("Dir", "", "C:/Roms", "", "");
   // CModel3
@@ -1690,6 +1999,15 @@ Util::Config::Node DefaultConfig()
   config.Set("PowerPCFrequency", 0u, "Core", 0u, 200u);
   config.Set("MultiThreaded", true, "Core");
   config.Set("GPUMultiThreaded", true, "Core");
+  config.Set("RewindBufferSize", 0u, "Core", 0u, 2048u);  // MB, 0 disables rewind
+  config.Set("RewindInterval", 2u, "Core", 1u, 60u);      // frames between snapshots
+  config.Set("RunAheadFrames", 0u, "Core", 0u, 4u);
+  config.Set("FastForwardInterval", 8u, "Core", 1u, 60u);  // frames per frame shown
+  config.Set("CompressSaveStates", false, "Core");
+  config.Set("CompressReplays", false, "Core");
+  config.Set("FixedRTC", false, "Core");    // RTC reads a fixed date instead of the host time (set for headless replay)
+  config.Set("HashInterval", 60u, "Core");  // frames between state hashes in headless replay (0 = only at end)
+  config.Set("ReplayKeyframeInterval", 10u, "Core");  // seconds between seek keyframes in recorded replays (0 disables)
   // 2D and 3D graphics engines
   config.Set("MultiTexture", false, "Legacy3D");
   config.Set<std::string>("VertexShader", "", "Legacy3D", "", "");
@@ -1715,6 +2033,7 @@ Util::Config::Node DefaultConfig()
   // Platform-specific/UI
   config.Set("New3DEngine", true, "Video");
   config.Set("QuadRendering", false, "Video");
+  config.Set("TexturePBO", false, "Video");
   config.Set("XResolution", 496, "Video");
   config.Set("YResolution", 384, "Video");
   config.SetEmpty("WindowXPosition");
@@ -2021,6 +2340,21 @@ static void Help(void)
   puts("  -gpu-multi-threaded     Run graphics rendering in separate thread [Default]");
   puts("  -no-gpu-thread          Run graphics rendering in main thread");
   puts("  -load-state=<file>      Load save state after starting");
+  puts("  -rom-cache=<dir>        Keep decoded ROM images in this directory for faster");
+  puts("                          startup (uses about as much disk space as the ROMs)");
+  puts("  -compress-states        Compress save state files");
+  puts("  -compress-replays       Compress recorded replay files");
+  puts("  -replay-headless        Play the -play replay with no window, sound or");
+  puts("                          throttling, printing memory hashes and frame rate");
+  puts("  -hash-interval=<n>      Frames between hashes in headless replay, 0 for");
+  puts("                          end only [Default: 60]");
+  puts("  -replay-keyframe-interval=<s> Seconds between seek keyframes in recorded");
+  puts("                          replays, 0 to disable [Default: 10]");
+  puts("  -replay-seek=<s>        Start the -play replay this many seconds in");
+  puts("  -rewind-buffer=<mb>     Memory for rewind history, 0 to disable [Default: 0]");
+  puts("  -rewind-interval=<n>    Frames between rewind snapshots [Default: 2]");
+  puts("  -run-ahead=<n>          Extra frames to run ahead to hide input lag (0-4) [Default: 0]");
+  puts("  -fast-forward-interval=<n> Show every Nth frame while fast-forwarding [Default: 8]");
   puts("");
   puts("Video Options:");
   puts("  -res=<x>,<y>            Resolution [Default: 496,384]");
@@ -2046,6 +2380,8 @@ static void Help(void)
   puts("  -crosshair-style=<s>    Crosshair style: vector or bmp. [Default: vector]");
   puts("  -new3d                  New 3D engine by Ian Curtis [Default]");
   puts("  -quad-rendering         Enable proper quad rendering");
+  puts("  -texture-pbo            Stream texture uploads through a pixel buffer (new");
+  puts("                          engine, needs OpenGL 4.4 or ARB_buffer_storage)");
   puts("  -legacy3d               Legacy 3D engine (faster but less accurate)");
   puts("  -multi-texture          Use 8 texture maps for decoding (legacy engine)");
   puts("  -no-multi-texture       Decode to single texture (legacy engine) [Default]");
@@ -2114,6 +2450,8 @@ struct ParsedCommandLine
   bool record = false;
   std::string record_file;
   std::string replay_play_file;
+  bool replay_headless = false;
+  unsigned replay_seek = 0;  // seconds
 #ifdef DEBUG
   std::string gfx_state;
 #endif
@@ -2133,7 +2471,14 @@ static ParsedCommandLine ParseCommandLine(int argc, char **argv)
   static const std::map<std::string, std::string> valued_options{// -option=value
                                                                  {"-game-xml-file", "GameXMLFile"},
                                                                  {"-load-state", "InitStateFile"},
+                                                                 {"-rom-cache", "ROMCacheDir"},
                                                                  {"-ppc-frequency", "PowerPCFrequency"},
+                                                                 {"-rewind-buffer", "RewindBufferSize"},
+                                                                 {"-rewind-interval", "RewindInterval"},
+                                                                 {"-run-ahead", "RunAheadFrames"},
+                                                                 {"-fast-forward-interval", "FastForwardInterval"},
+                                                                 {"-hash-interval", "HashInterval"},
+                                                                 {"-replay-keyframe-interval", "ReplayKeyframeInterval"},
                                                                  {"-crosshairs", "Crosshairs"},
                                                                  {"-crosshair-style", "CrosshairStyle"},
                                                                  {"-vert-shader", "VertexShader"},
@@ -2153,6 +2498,10 @@ static ParsedCommandLine ParseCommandLine(int argc, char **argv)
       {"-no-threads", {"MultiThreaded", false}},
       {"-gpu-multi-threaded", {"GPUMultiThreaded", true}},
       {"-no-gpu-thread", {"GPUMultiThreaded", false}},
+      {"-compress-states", {"CompressSaveStates", true}},
+      {"-no-compress-states", {"CompressSaveStates", false}},
+      {"-compress-replays", {"CompressReplays", true}},
+      {"-no-compress-replays", {"CompressReplays", false}},
       {"-window", {"FullScreen", false}},
       {"-fullscreen", {"FullScreen", true}},
       {"-borderless", {"BorderlessWindow", true}},
@@ -2172,6 +2521,8 @@ static ParsedCommandLine ParseCommandLine(int argc, char **argv)
       {"-no-fps", {"ShowFrameRate", false}},
       {"-new3d", {"New3DEngine", true}},
       {"-quad-rendering", {"QuadRendering", true}},
+      {"-texture-pbo", {"TexturePBO", true}},
+      {"-no-texture-pbo", {"TexturePBO", false}},
       {"-legacy3d", {"New3DEngine", false}},
       {"-no-flip-stereo", {"FlipStereo", false}},
       {"-flip-stereo", {"FlipStereo", true}},
@@ -2420,6 +2771,19 @@ static ParsedCommandLine ParseCommandLine(int argc, char **argv)
           cmd_line.error = true;
         }
       }
+      else if (arg == "-replay-headless")
+        cmd_line.replay_headless = true;
+      else if (arg.find("-replay-seek=") == 0)
+      {
+        std::vector<std::string> parts = Util::Format(arg).Split('=');
+        if (parts.size() == 2 && !parts[1].empty())
+          cmd_line.replay_seek = unsigned(std::strtoul(parts[1].c_str(), nullptr, 10));
+        else
+        {
+          ErrorLog("'-replay-seek' requires a time in seconds.");
+          cmd_line.error = true;
+        }
+      }
       else if (arg == "-hidecmd")
       {
       }
@@ -2582,12 +2946,6 @@ int main(int argc, char **argv)
     PrintGLInfo(true, false, false);
     return 0;
   }
-  // ★ 録画開始トリガー
-  if (cmd_line.record)
-  {
-    ReplayRecorder::Start(cmd_line.record_file.c_str());
-  }
-
 #ifdef DEBUG
   s_gfxStatePath.assign(cmd_line.gfx_state);
 #endif
@@ -2599,9 +2957,11 @@ int main(int argc, char **argv)
     return 0;
   }
 
-  // Load game and resolve run-time config
+  // Identify game and resolve run-time config. ROMs are loaded once the
+  // emulator has allocated its memory, so they can be placed there directly.
   Game game;
   ROMSet rom_set;
+  std::unique_ptr<GameLoader> loader;
 
   Util::Config::Node fileConfig("Global");
   {
@@ -2614,13 +2974,13 @@ int main(int argc, char **argv)
     if (rom_specified || print_games)
     {
       std::string xml_file = config3["GameXMLFile"].ValueAs<std::string>();
-      GameLoader loader(xml_file);
+      loader = std::make_unique<GameLoader>(xml_file);
       if (print_games)
       {
-        PrintGameList(xml_file, loader.GetGames());
+        PrintGameList(xml_file, loader->GetGames());
         return 0;
       }
-      if (loader.Load(&game, &rom_set, *cmd_line.rom_files.begin()))
+      if (loader->Identify(&game, *cmd_line.rom_files.begin()))
         return 1;
       Util::Config::MergeINISections(&config4, config3, fileConfig[game.name]); // apply game-specific config
     }
@@ -2630,6 +2990,13 @@ int main(int argc, char **argv)
   }
   LogConfig(s_runtime_config);
 
+  // ★ 録画開始トリガー（圧縮設定を読むため設定確定後に開始）
+  if (cmd_line.record)
+  {
+    ReplayRecorder::Start(cmd_line.record_file.c_str(), s_runtime_config["CompressReplays"].ValueAs<bool>(),
+                          SecondsToFrames(s_runtime_config["ReplayKeyframeInterval"].ValueAs<unsigned>()));
+  }
+
   // Initialize SDL (individual subsystems get initialized later)
   if (SDL_Init(0) != 0)
   {
@@ -2654,22 +3021,39 @@ int main(int argc, char **argv)
   aaValue = s_runtime_config["Supersampling"].ValueAs<int>();
   CRTcolors = (CRTcolor)s_runtime_config["CRTcolors"].ValueAs<int>();
 
-  // Create a window
-  xRes = 496;
-  yRes = 384;
-  if (Result::OKAY != CreateGLScreen(s_runtime_config["New3DEngine"].ValueAs<bool>(), s_runtime_config["QuadRendering"].ValueAs<bool>(), "Supermodel", false, &xOffset, &yOffset, &xRes, &yRes, &totalXRes, &totalYRes, false, false))
+  // Headless replay needs no window and runs single-threaded, with a fixed
+  // clock, for repeatability
+  if (cmd_line.replay_headless)
   {
-    exitCode = 1;
-    goto Exit;
+    if (cmd_line.replay_play_file.empty())
+    {
+      ErrorLog("'-replay-headless' requires a replay file ('-play').");
+      exitCode = 1;
+      goto Exit;
+    }
+    s_runtime_config.Get("MultiThreaded").SetValue(false);
+    s_runtime_config.Get("FixedRTC").SetValue(true);
   }
 
-  // Create Crosshair
-  s_crosshair = new CCrosshair(s_runtime_config);
-  if (s_crosshair->Init() != Result::OKAY)
+  // Create a window (not needed for headless replay)
+  xRes = 496;
+  yRes = 384;
+  if (!cmd_line.replay_headless)
   {
-    ErrorLog("Unable to load bitmap crosshair texture\n");
-    exitCode = 1;
-    goto Exit;
+    if (Result::OKAY != CreateGLScreen(s_runtime_config["New3DEngine"].ValueAs<bool>(), s_runtime_config["QuadRendering"].ValueAs<bool>(), "Supermodel", false, &xOffset, &yOffset, &xRes, &yRes, &totalXRes, &totalYRes, false, false))
+    {
+      exitCode = 1;
+      goto Exit;
+    }
+
+    // Create Crosshair
+    s_crosshair = new CCrosshair(s_runtime_config);
+    if (s_crosshair->Init() != Result::OKAY)
+    {
+      ErrorLog("Unable to load bitmap crosshair texture\n");
+      exitCode = 1;
+      goto Exit;
+    }
   }
 
   // Create Model 3 emulator
@@ -2712,6 +3096,7 @@ int main(int argc, char **argv)
     InfoLog("Replay play: %s", cmd_line.replay_play_file.c_str());
     replayRequested = true;
     replayFile = cmd_line.replay_play_file;
+    replaySeekSeconds = cmd_line.replay_seek;
   }
 
   // NOTE: fileConfig is passed so that the global section is used for input settings
@@ -2757,6 +3142,23 @@ int main(int argc, char **argv)
     goto Exit;
   }
 
+  // Initialize emulator and load ROMs into it
+  if (Result::OKAY != Model3->Init() ||
+      loader->Load(&game, &rom_set, *cmd_line.rom_files.begin(), [Model3](const std::string &region_name, size_t region_size) { return Model3->GetROMDestination(region_name, region_size); },
+                   s_runtime_config["ROMCacheDir"].ValueAs<std::string>()))
+  {
+    exitCode = 1;
+    delete Model3;
+    goto Exit;
+  }
+
+  if (cmd_line.replay_headless)
+  {
+    exitCode = RunHeadlessReplay(game, &rom_set, Model3, Inputs, cmd_line.replay_play_file);
+    delete Model3;
+    goto Exit;
+  }
+
 #ifdef SUPERMODEL_DEBUGGER
   // Create Supermodel debugger unless debugging is disabled
   if (!cmd_line.disable_debugger)
@@ -178,10 +178,11 @@ CSDLInputSystem::CSDLInputSystem(const Util::Config::Node& config, bool useGameC
     m_mouseZ(0),
     m_mouseWheelDir(0),
     m_mouseButtons(0),
-    sdlConstForceMax(0),
-    sdlSelfCenterMax(0),
-    sdlFrictionMax(0),
-    sdlVibrateMax(0)
+    sdlConstForceMax(config.Get("SDLConstForceMax")),
+    sdlSelfCenterMax(config.Get("SDLSelfCenterMax")),
+    sdlFrictionMax(config.Get("SDLFrictionMax")),
+    sdlVibrateMax(config.Get("SDLVibrateMax")),
+    sdlConstForceThreshold(config.Get("SDLConstForceThreshold"))
 {
   memset(&eff, 0, sizeof(SDL_HapticEffect));
 }
@@ -617,40 +618,48 @@ bool CSDLInputSystem::ProcessForceFeedbackCmd(int joyNum, int axisNum, ForceFeed
       break;
 
     case FFConstantForce:
-      sdlConstForceMax = m_config["SDLConstForceMax"].ValueAs<unsigned>();
-      if (sdlConstForceMax == 0)
+    {
+      unsigned constForceMax = sdlConstForceMax.Get();
+      if (constForceMax == 0)
         return false;
       // note sr2 centering val=0.047244 and val=0.062992 alternatively (const value)
       //          max val between -1 to 1 (left right)
       if (ffCmd.force == 0.0f)
         StopConstanteforce(joyNum);
       else if (ffCmd.force > 0.0f)
-        ConstantForceEffect(ffCmd.force * (float)(sdlConstForceMax / 100.0f), -1, SDL_HAPTIC_INFINITY, joyNum);
+        ConstantForceEffect(ffCmd.force * (float)(constForceMax / 100.0f), -1, SDL_HAPTIC_INFINITY, joyNum);
       else if (ffCmd.force < 0.0f)
-        ConstantForceEffect(-ffCmd.force * (float)(sdlConstForceMax / 100.0f), 1, SDL_HAPTIC_INFINITY, joyNum);
+        ConstantForceEffect(-ffCmd.force * (float)(constForceMax / 100.0f), 1, SDL_HAPTIC_INFINITY, joyNum);
       break;
+    }
 
     case FFSelfCenter:
-      sdlSelfCenterMax = m_config["SDLSelfCenterMax"].ValueAs<unsigned>();
-      if (sdlSelfCenterMax == 0)
+    {
+      unsigned selfCenterMax = sdlSelfCenterMax.Get();
+      if (selfCenterMax == 0)
         return false;
-      SpringForceEffect(ffCmd.force * (float)(sdlSelfCenterMax / 100.0f), joyNum);
+      SpringForceEffect(ffCmd.force * (float)(selfCenterMax / 100.0f), joyNum);
       break;
+    }
 
     case FFFriction:
-      sdlFrictionMax = m_config["SDLFrictionMax"].ValueAs<unsigned>();
-      if (sdlFrictionMax == 0)
+    {
+      unsigned frictionMax = sdlFrictionMax.Get();
+      if (frictionMax == 0)
         return false;
-      FrictionForceEffect(ffCmd.force * (float)(sdlFrictionMax / 100.0f), joyNum);
+      FrictionForceEffect(ffCmd.force * (float)(frictionMax / 100.0f), joyNum);
       break;
+    }
 
     case FFVibrate:
-      sdlVibrateMax = m_config["SDLVibrateMax"].ValueAs<unsigned>();
-      if (sdlVibrateMax == 0)
+    {
+      unsigned vibrateMax = sdlVibrateMax.Get();
+      if (vibrateMax == 0)
         return false;
-      VibrationEffect(ffCmd.force * (float)(sdlVibrateMax / 100.0f), joyNum);
+      VibrationEffect(ffCmd.force * (float)(vibrateMax / 100.0f), joyNum);
       break;
     }
+    }
     return true;
 }
 
@@ -872,7 +881,7 @@ void CSDLInputSystem::ConstantForceEffect(float force, int dir, int length, int
   }
   else
   {
-    float threshold = (float)m_config["SDLConstForceThreshold"].ValueAs<unsigned>() / 100.0f;
+    float threshold = (float)sdlConstForceThreshold.Get() / 100.0f;
     if (force != 0.0f && force > threshold)
       SDL_HapticRumblePlay(m_SDLHapticDatas[joyNum].SDLhaptic, force, 200);
     else
@@ -76,12 +76,14 @@ private:
 	short m_mouseWheelDir;
 	Uint8 m_mouseButtons;
 
-	// SDL2 ffb
+	// SDL2 ffb (strengths are kept up to date by config observers, since
+	// force feedback commands may arrive on the drive board thread)
 	SDL_HapticEffect eff;
-	unsigned sdlConstForceMax;
-	unsigned sdlSelfCenterMax;
-	unsigned sdlFrictionMax;
-	unsigned sdlVibrateMax;
+	Util::Config::Observed<unsigned> sdlConstForceMax;
+	Util::Config::Observed<unsigned> sdlSelfCenterMax;
+	Util::Config::Observed<unsigned> sdlFrictionMax;
+	Util::Config::Observed<unsigned> sdlVibrateMax;
+	Util::Config::Observed<unsigned> sdlConstForceThreshold;
 	struct hapticInfo
 	{
 		SDL_Haptic* SDLhaptic = NULL;
@@ -0,0 +1,162 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2003-2022 The Supermodel Team
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "VirtualMemory.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace VirtualMemory
+{
+    static const size_t HUGE_PAGE_SIZE = 0x200000;
+
+    // Explicit huge page allocations, which are freed with their rounded-up
+    // size and cannot have files mapped into them
+    static std::mutex s_hugePageMutex;
+    static std::map<uint8_t *, size_t> s_hugePageAllocations;
+
+    static bool IsInHugePages(void *ptr)
+    {
+        std::lock_guard<std::mutex> lock(s_hugePageMutex);
+        auto it = s_hugePageAllocations.upper_bound((uint8_t *) ptr);
+        if (it == s_hugePageAllocations.begin())
+            return false;
+        --it;
+        return (uint8_t *) ptr < it->first + it->second;
+    }
+
+    // madvise() succeeds whenever the kernel supports transparent huge pages,
+    // even if they have been turned off
+    static bool TransparentHugePagesEnabled()
+    {
+        FILE *fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+        if (!fp)
+            return false;
+        char mode[128] = {};
+        bool enabled = fgets(mode, sizeof(mode), fp) != nullptr && strstr(mode, "[never]") == nullptr;
+        fclose(fp);
+        return enabled;
+    }
+
+    size_t GetPageSize()
+    {
+        return size_t(sysconf(_SC_PAGESIZE));
+    }
+
+    void *Allocate(size_t size, PageType *pageType, bool fullyUsed)
+    {
+        PageType type = SmallPages;
+
+#ifdef MAP_HUGETLB
+        // Explicit huge pages are only available if the administrator has
+        // reserved some (vm.nr_hugepages)
+        size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        void *hugePtr = fullyUsed ? mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0) : MAP_FAILED;
+        if (hugePtr != MAP_FAILED)
+        {
+            std::lock_guard<std::mutex> lock(s_hugePageMutex);
+            s_hugePageAllocations[(uint8_t *) hugePtr] = hugeSize;
+            if (pageType)
+                *pageType = HugePages;
+            return hugePtr;
+        }
+#endif
+
+        // Otherwise, over-allocate so that the memory can start on a huge page
+        // boundary, which lets transparent huge pages cover all of it
+        size_t pageSize = GetPageSize();
+        size_t alignment = size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : pageSize;
+        size = (size + pageSize - 1) & ~(pageSize - 1);
+        uint8_t *ptr = (uint8_t *) mmap(nullptr, size + alignment - pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (ptr == (uint8_t *) MAP_FAILED)
+            return nullptr;
+        uint8_t *alignedPtr = (uint8_t *) ((uintptr_t(ptr) + alignment - 1) & ~uintptr_t(alignment - 1));
+        if (alignedPtr != ptr)
+            munmap(ptr, alignedPtr - ptr);
+        if (alignment > pageSize && alignedPtr + size != ptr + size + alignment - pageSize)
+            munmap(alignedPtr + size, (ptr + size + alignment - pageSize) - (alignedPtr + size));
+
+#ifdef MADV_HUGEPAGE
+        if (alignment == HUGE_PAGE_SIZE && madvise(alignedPtr, size, MADV_HUGEPAGE) == 0 && TransparentHugePagesEnabled())
+            type = TransparentHugePages;
+#endif
+        if (pageType)
+            *pageType = type;
+        return alignedPtr;
+    }
+
+    void Free(void *ptr, size_t size)
+    {
+        if (!ptr)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(s_hugePageMutex);
+            auto it = s_hugePageAllocations.find((uint8_t *) ptr);
+            if (it != s_hugePageAllocations.end())
+            {
+                size = it->second;
+                s_hugePageAllocations.erase(it);
+            }
+        }
+        munmap(ptr, size);
+    }
+
+    void Discard(void *ptr, size_t size)
+    {
+        // Explicit huge pages cannot be partially dropped, so they are cleared
+        size_t pageSize = GetPageSize();
+        uint8_t *start = (uint8_t *) ((uintptr_t(ptr) + pageSize - 1) & ~uintptr_t(pageSize - 1));
+        uint8_t *end = (uint8_t *) ((uintptr_t(ptr) + size) & ~uintptr_t(pageSize - 1));
+        if (start >= end || IsInHugePages(ptr) || madvise(start, end - start, MADV_DONTNEED) != 0)
+        {
+            memset(ptr, 0, size);
+            return;
+        }
+        memset(ptr, 0, start - (uint8_t *) ptr);
+        memset(end, 0, (uint8_t *) ptr + size - end);
+    }
+
+    bool MapFile(void *dest, size_t size, const std::string &filename, uint64_t offset)
+    {
+        size_t pageSize = GetPageSize();
+        if (uintptr_t(dest) % pageSize != 0 || size % pageSize != 0 || offset % pageSize != 0 || IsInHugePages(dest))
+            return false;
+
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat fileInfo;
+        bool ok = fstat(fd, &fileInfo) == 0 && uint64_t(fileInfo.st_size) >= offset + size;
+        if (ok && mmap(dest, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, off_t(offset)) == MAP_FAILED)
+        {
+            // A failed MAP_FIXED may have unmapped the range, so put back zeroed memory
+            mmap(dest, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0);
+            ok = false;
+        }
+        close(fd);
+        return ok;
+    }
+}
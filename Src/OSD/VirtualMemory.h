@@ -0,0 +1,77 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2003-2022 The Supermodel Team
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/*
+ * VirtualMemory.h
+ *
+ * Header file for OS-dependent page-level memory management.
+ */
+
+#ifndef INCLUDED_VIRTUALMEMORY_H
+#define INCLUDED_VIRTUALMEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace VirtualMemory
+{
+    enum PageType { SmallPages, TransparentHugePages, HugePages }; // Backing obtained by Allocate()
+
+    inline const char *GetPageTypeName(PageType pageType)
+    {
+        switch (pageType)
+        {
+        case TransparentHugePages:
+            return "transparent huge pages";
+        case HugePages:
+            return "huge pages";
+        default:
+            return "regular pages";
+        }
+    }
+
+    size_t GetPageSize(); // Alignment required by MapFile() for addresses, sizes, and file offsets
+
+    // Allocates zero-filled, page-aligned memory (nullptr on failure). It is
+    // backed by transparent huge pages where possible. Explicit huge pages are
+    // reserved and pinned in full up front, and files cannot be mapped into
+    // them, so they are only tried if fullyUsed is set (i.e., the caller will
+    // touch all of the memory anyway).
+    void *Allocate(size_t size, PageType *pageType = nullptr, bool fullyUsed = false);
+
+    void Free(void *ptr, size_t size); // Frees memory from Allocate()
+
+    // Zero-fills memory from Allocate(). Where this cannot fail (not on
+    // Windows), whole pages are handed back to the OS rather than written, so
+    // that they stop counting towards the resident set until touched again.
+    void Discard(void *ptr, size_t size);
+
+    // Replaces size bytes of memory from Allocate() at dest with a private
+    // (copy-on-write) mapping of a file, so that pages are only read from disk
+    // when touched. Returns false if this is not possible (e.g., the memory is
+    // backed by explicit huge pages), in which case the caller should read the
+    // data normally.
+    bool MapFile(void *dest, size_t size, const std::string &filename, uint64_t offset);
+}
+
+
+#endif // INCLUDED_VIRTUALMEMORY_H
@@ -0,0 +1,79 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2003-2022 The Supermodel Team
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "VirtualMemory.h"
+#include <cstdint>
+#include <cstring>
+#include <windows.h>
+
+namespace VirtualMemory
+{
+    size_t GetPageSize()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return size_t(info.dwAllocationGranularity);
+    }
+
+    void *Allocate(size_t size, PageType *pageType, bool fullyUsed)
+    {
+        // Large pages require the "Lock pages in memory" privilege, so this
+        // usually fails and regular pages are used. They are always committed
+        // in full, so are only worth it for memory that is used in full.
+        size_t largePageSize = fullyUsed ? GetLargePageMinimum() : 0;
+        if (largePageSize)
+        {
+            size_t largeSize = (size + largePageSize - 1) & ~(largePageSize - 1);
+            void *ptr = VirtualAlloc(nullptr, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (ptr)
+            {
+                if (pageType)
+                    *pageType = HugePages;
+                return ptr;
+            }
+        }
+        if (pageType)
+            *pageType = SmallPages;
+        return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+
+    void Free(void *ptr, size_t size)
+    {
+        if (!ptr)
+            return;
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+
+    void Discard(void *ptr, size_t size)
+    {
+        // Decommitting would give the range back to the commit charge, and
+        // recommitting it can then fail. This is called on reset, which must
+        // not fail, so the memory is simply cleared.
+        memset(ptr, 0, size);
+    }
+
+    // Views cannot be placed inside an existing allocation without placeholder
+    // support, so files are always read in
+    bool MapFile(void *dest, size_t size, const std::string &filename, uint64_t offset)
+    {
+        return false;
+    }
+}
@@ -13,31 +13,38 @@ void ROM::CopyTo(uint8_t *dest, size_t dest_size, bool apply_patches ) const
   memcpy(dest, src, bytes_to_copy);
   
   if (apply_patches)
+    ApplyPatches(dest, dest_size);
+}
+
+void ROM::ApplyPatches(uint8_t *dest, size_t dest_size, unsigned word_size) const
+{
+  // Patch offsets refer to the big endian layout. If the data has already been
+  // converted to little endian words, each byte address is mirrored within its
+  // word (word_size must be a power of 2).
+  size_t swizzle = word_size - 1;
+  for (auto &patch: patches)
   {
-    for (auto &patch: patches)
+    unsigned bytes = patch.bits / 8;
+    if (patch.offset + bytes > dest_size)
     {
-      unsigned bytes = patch.bits / 8;
-      if (patch.offset + bytes > dest_size)
-      {
-        ErrorLog("Ignored ROM patch to offset 0x%x in region 0x%x bytes long.", patch.offset, dest_size);
-        continue;
-      }
-      uint64_t value = patch.value;
-      switch (patch.bits)
+      ErrorLog("Ignored ROM patch to offset 0x%x in region 0x%x bytes long.", patch.offset, dest_size);
+      continue;
+    }
+    uint64_t value = patch.value;
+    switch (patch.bits)
+    {
+    case 8:
+    case 16:
+    case 32:
+    case 64:
+      for (size_t i = 0; i < bytes; i++)
       {
-      case 8:
-      case 16:
-      case 32:
-      case 64:
-        for (size_t i = 0; i < bytes; i++)
-        {
-          dest[patch.offset + bytes - 1 - i] = value & 0xff;
-          value >>= 8;
-        }
-        break;
-      default:
-        break;
+        dest[(patch.offset + bytes - 1 - i) ^ swizzle] = value & 0xff;
+        value >>= 8;
       }
+      break;
+    default:
+      break;
     }
   }
 }
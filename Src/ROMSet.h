@@ -1,6 +1,7 @@
 #ifndef INCLUDED_ROMSET_H
 #define INCLUDED_ROMSET_H
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <map>
@@ -26,9 +27,28 @@ struct ROM
   std::shared_ptr<uint8_t> data;
   std::vector<BigEndianPatch> patches;
   size_t size = 0;
+  bool in_place = false;  // data is in emulator memory, already patched and word swapped (see ROMDestination)
+  std::string mapped_file;  // ROM cache file that in-place data is memory mapped from, if any
+  uint64_t mapped_offset = 0;
   
   void CopyTo(uint8_t *dest, size_t dest_size, bool apply_patches = true) const;
+  void ApplyPatches(uint8_t *dest, size_t dest_size, unsigned word_size = 1) const;
 };
+
+/*
+ * Location in emulator memory that a ROM region can be loaded into directly,
+ * avoiding an intermediate copy. word_size is 2 or 4 if the emulator wants
+ * the region as little endian words of that size, otherwise 1. A null ptr
+ * means the region is to be loaded into a separate buffer as usual.
+ */
+struct ROMDestination
+{
+  uint8_t *ptr = nullptr;
+  size_t capacity = 0;
+  unsigned word_size = 1;
+};
+
+typedef std::function<ROMDestination(const std::string &region_name, size_t region_size)> ROMDestinationFn;
   
 struct ROMSet
 {
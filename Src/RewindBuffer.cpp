@@ -0,0 +1,333 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2011 Bart Trzynadlowski, Nik Henson
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/*
+ * RewindBuffer.cpp
+ *
+ * Rewind snapshot ring buffer. Implementation of the CRewindBuffer class.
+ *
+ * Delta Format
+ * ------------
+ * Each delta is a zlib stream of records:
+ *
+ *  pageIndex   (uint32_t)  Index of the page within the snapshot.
+ *  data        ...         DELTA_PAGE_SIZE bytes, newer XOR older snapshot.
+ *
+ * Snapshots are treated as zero-padded to a multiple of the page size, so
+ * size changes between snapshots need no special handling beyond recording
+ * the size to truncate to on restore.
+ */
+
+#include "RewindBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+#include "Supermodel.h"
+#include "BlockFile.h"
+#include "Model3/IEmulator.h"
+
+
+/******************************************************************************
+ Delta Encoding
+******************************************************************************/
+
+// XORs page b into page a (size must be a multiple of 8)
+static inline void XorPage(uint8_t *a, const uint8_t *b, size_t size)
+{
+  for (size_t i = 0; i < size; i += sizeof(uint64_t))
+  {
+    uint64_t x, y;
+    memcpy(&x, &a[i], sizeof(x));
+    memcpy(&y, &b[i], sizeof(y));
+    x ^= y;
+    memcpy(&a[i], &x, sizeof(x));
+  }
+}
+
+// Copies one page, zero-padding past the end of the source data
+static inline void LoadPage(uint8_t *dest, const std::vector<uint8_t> &src, size_t offset, size_t pageSize)
+{
+  size_t len = offset < src.size() ? (std::min)(pageSize, src.size() - offset) : 0;
+  if (len)
+    memcpy(dest, &src[offset], len);
+  memset(dest + len, 0, pageSize - len);
+}
+
+static bool IsZero(const uint8_t *data, size_t size)
+{
+  for (size_t i = 0; i < size; i += sizeof(uint64_t))
+  {
+    uint64_t x;
+    memcpy(&x, &data[i], sizeof(x));
+    if (x)
+      return false;
+  }
+  return true;
+}
+
+
+/******************************************************************************
+ Rewind Buffer
+******************************************************************************/
+
+void CRewindBuffer::Capture(IEmulator *Model3)
+{
+  Wait();
+  bool first = m_current.empty();
+  std::vector<uint8_t> *dest = first ? &m_current : &m_scratch;
+
+  CBlockFile state;
+  state.Create(dest, "Supermodel Rewind State", "Supermodel Version " SUPERMODEL_VERSION);
+  Model3->SaveState(&state);
+  state.Close();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (first)
+  {
+    m_numSnapshots = 1;
+    return;
+  }
+
+  // Encode the delta in the background
+  if (!m_worker.joinable())
+    m_worker = std::thread(&CRewindBuffer::WorkerThread, this);
+  m_pending = true;
+  m_cond.notify_all();
+}
+
+void CRewindBuffer::WorkerThread(void)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_cond.wait(lock, [this] { return m_pending || m_exit; });
+    if (m_exit)
+      return;
+    lock.unlock();
+    EncodeDelta();
+    lock.lock();
+    m_pending = false;
+    m_numSnapshots = m_deltas.size() + 1;
+    m_cond.notify_all();
+  }
+}
+
+void CRewindBuffer::Wait(void) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this] { return !m_pending; });
+}
+
+void CRewindBuffer::EncodeDelta(void)
+{
+  // Record whatever pages must be XORed into the new snapshot to get back the
+  // current one. Unchanged pages are skipped with a quick comparison.
+  const std::vector<uint8_t> &newer = m_scratch;
+  const std::vector<uint8_t> &older = m_current;
+  size_t totalSize = (std::max)(newer.size(), older.size());
+  size_t numPages = (totalSize + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE;
+  m_raw.clear();
+  for (size_t page = 0; page < numPages; page++)
+  {
+    size_t offset = page * DELTA_PAGE_SIZE;
+    if (offset + DELTA_PAGE_SIZE <= newer.size() && offset + DELTA_PAGE_SIZE <= older.size())
+    {
+      if (!memcmp(&newer[offset], &older[offset], DELTA_PAGE_SIZE))
+        continue;
+    }
+
+    uint8_t a[DELTA_PAGE_SIZE], b[DELTA_PAGE_SIZE];
+    LoadPage(a, newer, offset, DELTA_PAGE_SIZE);
+    LoadPage(b, older, offset, DELTA_PAGE_SIZE);
+    XorPage(a, b, DELTA_PAGE_SIZE);
+    if (IsZero(a, DELTA_PAGE_SIZE))
+      continue;
+
+    uint32_t index = uint32_t(page);
+    const uint8_t *indexBytes = reinterpret_cast<const uint8_t *>(&index);
+    m_raw.insert(m_raw.end(), indexBytes, indexBytes + sizeof(index));
+    m_raw.insert(m_raw.end(), a, a + DELTA_PAGE_SIZE);
+  }
+
+  // Compress. The XORed pages are mostly zero and compress very well even at
+  // the fastest setting.
+  Delta delta;
+  delta.prevSize = uint32_t(older.size());
+  delta.rawSize = uint32_t(m_raw.size());
+  if (!m_raw.empty())
+  {
+    uLongf packedSize = compressBound(uLong(m_raw.size()));
+    if (m_zbuf.size() < packedSize)
+      m_zbuf.resize(packedSize);
+    if (Z_OK != compress2(m_zbuf.data(), &packedSize, m_raw.data(), uLong(m_raw.size()), Z_BEST_SPEED))
+    {
+      // Can't continue the chain without this delta; start over from here
+      ErrorLog("Unable to compress rewind snapshot. Rewind buffer cleared.");
+      m_deltas.clear();
+      m_deltaBytes = 0;
+      m_current.swap(m_scratch);
+      return;
+    }
+    delta.packed.assign(m_zbuf.begin(), m_zbuf.begin() + packedSize);
+  }
+
+  m_deltaBytes += delta.packed.size() + sizeof(Delta);
+  m_deltas.emplace_back(std::move(delta));
+  m_current.swap(m_scratch);
+  ReleaseLargeBuffers();
+  Trim();
+}
+
+bool CRewindBuffer::Tick(void)
+{
+  if (m_budget == 0)
+    return false;
+  if (++m_frameCount < m_interval)
+    return false;
+  m_frameCount = 0;
+  return true;
+}
+
+Result CRewindBuffer::Rewind(IEmulator *Model3)
+{
+  Wait();
+  if (m_current.empty())
+    return Result::FAIL;
+
+  // Step back to the previous snapshot (oldest one stays put)
+  if (!m_deltas.empty())
+  {
+    Delta &delta = m_deltas.back();
+    if (delta.rawSize)
+    {
+      m_raw.resize(delta.rawSize);
+      uLongf rawSize = delta.rawSize;
+      if (Z_OK != uncompress(m_raw.data(), &rawSize, delta.packed.data(), uLong(delta.packed.size())) || rawSize != delta.rawSize)
+      {
+        ErrorLog("Rewind snapshot is corrupt. Rewind buffer cleared.");
+        Clear();
+        return Result::FAIL;
+      }
+      size_t paddedSize = ((std::max)(m_current.size(), size_t(delta.prevSize)) + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE * DELTA_PAGE_SIZE;
+      m_current.resize(paddedSize);
+      for (size_t pos = 0; pos + sizeof(uint32_t) + DELTA_PAGE_SIZE <= m_raw.size(); pos += sizeof(uint32_t) + DELTA_PAGE_SIZE)
+      {
+        uint32_t index;
+        memcpy(&index, &m_raw[pos], sizeof(index));
+        if ((size_t(index) + 1) * DELTA_PAGE_SIZE > paddedSize)
+          continue;
+        XorPage(&m_current[size_t(index) * DELTA_PAGE_SIZE], &m_raw[pos + sizeof(uint32_t)], DELTA_PAGE_SIZE);
+      }
+    }
+    m_current.resize(delta.prevSize);
+    ReleaseLargeBuffers();
+    m_deltaBytes -= delta.packed.size() + sizeof(Delta);
+    m_deltas.pop_back();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_numSnapshots = m_deltas.size() + 1;
+  }
+
+  CBlockFile state;
+  state.Load(m_current.data(), m_current.size());
+  Model3->LoadState(&state);
+  state.Close();
+
+  // Restart the capture interval so that the next snapshot is a full interval
+  // after the one just loaded
+  m_frameCount = 0;
+  return Result::OKAY;
+}
+
+void CRewindBuffer::Trim(void)
+{
+  // Only the deltas count against the budget. The working buffers are a fixed
+  // overhead of a few whole snapshots, and counting them would leave nothing
+  // for history with small budgets.
+  while (!m_deltas.empty() && m_deltaBytes > m_budget)
+  {
+    m_deltaBytes -= m_deltas.front().packed.size() + sizeof(Delta);
+    m_deltas.pop_front();
+  }
+}
+
+void CRewindBuffer::ReleaseLargeBuffers(void)
+{
+  // Most deltas are a small fraction of a snapshot, but a stage load can
+  // change nearly everything at once. Don't hold on to buffers sized for that.
+  if (m_raw.capacity() + m_zbuf.capacity() > m_current.size() / 4)
+  {
+    std::vector<uint8_t>().swap(m_raw);
+    std::vector<uint8_t>().swap(m_zbuf);
+  }
+}
+
+void CRewindBuffer::Clear(void)
+{
+  Wait();
+  m_deltas.clear();
+  m_deltaBytes = 0;
+  m_current.clear();
+  m_frameCount = 0;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_numSnapshots = 0;
+}
+
+void CRewindBuffer::Configure(size_t budgetBytes, unsigned interval)
+{
+  Clear();
+  m_budget = budgetBytes;
+  m_interval = (std::max)(1u, interval);
+}
+
+size_t CRewindBuffer::NumSnapshots(void) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numSnapshots;
+}
+
+size_t CRewindBuffer::BytesUsed(void) const
+{
+  Wait();
+  return Usage();
+}
+
+size_t CRewindBuffer::Usage(void) const
+{
+  return m_current.capacity() + m_scratch.capacity() + m_raw.capacity() + m_zbuf.capacity() + m_deltaBytes;
+}
+
+CRewindBuffer::CRewindBuffer(void)
+{
+}
+
+CRewindBuffer::~CRewindBuffer(void)
+{
+  if (m_worker.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_exit = true;
+      m_cond.notify_all();
+    }
+    m_worker.join();
+  }
+}
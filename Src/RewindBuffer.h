@@ -0,0 +1,178 @@
+/**
+ ** Supermodel
+ ** A Sega Model 3 Arcade Emulator.
+ ** Copyright 2011 Bart Trzynadlowski, Nik Henson
+ **
+ ** This file is part of Supermodel.
+ **
+ ** Supermodel is free software: you can redistribute it and/or modify it under
+ ** the terms of the GNU General Public License as published by the Free
+ ** Software Foundation, either version 3 of the License, or (at your option)
+ ** any later version.
+ **
+ ** Supermodel is distributed in the hope that it will be useful, but WITHOUT
+ ** ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ ** FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ ** more details.
+ **
+ ** You should have received a copy of the GNU General Public License along
+ ** with Supermodel.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/*
+ * RewindBuffer.h
+ *
+ * Header file for the rewind snapshot ring buffer.
+ */
+
+#ifndef INCLUDED_REWINDBUFFER_H
+#define INCLUDED_REWINDBUFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Types.h"
+
+class IEmulator;
+
+/*
+ * CRewindBuffer:
+ *
+ * Ring buffer of machine snapshots used to step emulation backwards.
+ *
+ * Snapshots are ordinary save states written to memory. Only the most recent
+ * one is kept whole. For every older snapshot, only the pages that differ from
+ * its successor are stored, XORed against it and then zlib-compressed. Most
+ * of the large memory regions (main RAM, Real3D memory, tile generator VRAM)
+ * change very little from one frame to the next, so these deltas are small.
+ *
+ * Only the save state itself is taken on the calling thread. Diffing and
+ * compressing it against the previous snapshot is done on a worker thread
+ * while emulation carries on; the next Capture() or Rewind() waits for it.
+ *
+ * Rewinding XORs the newest delta back into the whole snapshot, yielding the
+ * previous one, and loads it. This is cheap enough to do once per frame. When
+ * the memory budget is exceeded, the oldest deltas are discarded.
+ *
+ * Capture() and Rewind() must only be called while the emulator threads are
+ * paused.
+ */
+class CRewindBuffer
+{
+public:
+  /*
+   * Configure(budgetBytes, interval):
+   *
+   * Sets the memory budget and capture interval. Clears the buffer.
+   *
+   * Parameters:
+   *    budgetBytes   Maximum number of bytes to use for the compressed
+   *                  deltas. The working buffers (the uncompressed most
+   *                  recent snapshot and a few buffers of similar size) come
+   *                  on top of this.
+   *    interval      Number of frames between snapshots (at least 1).
+   */
+  void Configure(size_t budgetBytes, unsigned interval);
+
+  /*
+   * Tick(void):
+   *
+   * To be called once per emulated frame.
+   *
+   * Returns:
+   *    True if a snapshot is due (every interval frames), in which case the
+   *    caller should pause the emulator threads and call Capture().
+   */
+  bool Tick(void);
+
+  /*
+   * Capture(Model3):
+   *
+   * Captures a snapshot immediately.
+   *
+   * Parameters:
+   *    Model3  Emulator to snapshot.
+   */
+  void Capture(IEmulator *Model3);
+
+  /*
+   * Rewind(Model3):
+   *
+   * Steps the buffer one snapshot back and loads it into the emulator. Once
+   * the oldest snapshot is reached, it is reloaded on each subsequent call.
+   * Capturing resumes from the loaded snapshot.
+   *
+   * Parameters:
+   *    Model3  Emulator to restore.
+   *
+   * Returns:
+   *    OKAY if a snapshot was loaded, FAIL if the buffer is empty or a delta
+   *    was corrupt.
+   */
+  Result Rewind(IEmulator *Model3);
+
+  /*
+   * Clear(void):
+   *
+   * Discards all snapshots. Should be called whenever the machine state is
+   * changed by other means (reset, loading a save state).
+   */
+  void Clear(void);
+
+  /*
+   * NumSnapshots(void):
+   * BytesUsed(void):
+   *
+   * Returns:
+   *    Number of snapshots that can be stepped back to and total memory
+   *    currently in use, including the working buffers.
+   */
+  size_t NumSnapshots(void) const;
+  size_t BytesUsed(void) const;
+
+  CRewindBuffer(void);
+  ~CRewindBuffer(void);
+
+private:
+  static const size_t DELTA_PAGE_SIZE = 4096;
+
+  struct Delta
+  {
+    uint32_t              prevSize;   // size of the snapshot this delta restores
+    uint32_t              rawSize;    // size of packed data before compression
+    std::vector<uint8_t>  packed;     // compressed (page index, XOR page) records
+  };
+
+  void    EncodeDelta(void);
+  void    Trim(void);
+  void    ReleaseLargeBuffers(void);
+  size_t  Usage(void) const;
+  void    Wait(void) const;
+  void    WorkerThread(void);
+
+  std::deque<Delta>     m_deltas;     // oldest at front
+  std::vector<uint8_t>  m_current;    // most recent snapshot, uncompressed
+  std::vector<uint8_t>  m_scratch;    // next snapshot being captured
+  std::vector<uint8_t>  m_raw;        // uncompressed delta records
+  std::vector<uint8_t>  m_zbuf;       // compression output
+  size_t                m_deltaBytes = 0;
+  size_t                m_budget = 0;
+  unsigned              m_interval = 1;
+  unsigned              m_frameCount = 0;
+
+  // Worker thread that encodes m_scratch into a delta. The buffers above are
+  // owned by the worker while m_pending is set.
+  std::thread                     m_worker;
+  mutable std::mutex              m_mutex;
+  mutable std::condition_variable m_cond;
+  bool                            m_pending = false;
+  bool                            m_exit = false;
+  size_t                          m_numSnapshots = 0;
+};
+
+
+#endif  // INCLUDED_REWINDBUFFER_H
@@ -76,7 +76,7 @@ Anyways credit to R. Belmont and ElSemi for the code, and for being awesome emul
 #include <cmath>
 
 
-static const Util::Config::Node *s_config = 0;
+static Util::Config::Observed<float> s_balance(0.0f);
 static bool s_multiThreaded = false;
 bool legacySound; // For LegacySound (SCSP DSP) config option.
 
@@ -592,7 +592,7 @@ void SCSP_StopSlot(_SLOT *slot,int keyoff)
 
 Result SCSP_Init(const Util::Config::Node &config, int n)
 {
-	s_config = &config;
+	s_balance.Observe(config.Get("Balance"));
 	s_multiThreaded = config["MultiThreaded"].ValueAs<bool>();
 	legacySound = config["LegacySoundDSP"].ValueAs<bool>();
 
@@ -1511,7 +1511,7 @@ void SCSP_DoMasterSamples(int nsamples)
 	 * When one SCSP is fully attenuated, the other's samples will be multiplied
 	 * by 2.
 	 */
-	float balance = std::max(-100.f,std::min(100.f,s_config->Get("Balance").ValueAs<float>()));
+	float balance = std::max(-100.f,std::min(100.f,s_balance.Get()));
 	balance *= 0.01f;
 	float masterBalance = 1.0f + balance;
 	float slaveBalance = 1.0f - balance;
@@ -153,6 +153,32 @@ namespace Util
 {
   namespace Config
   {
+    std::atomic<uint64_t> Node::s_version(1);
+
+    Subscription Node::AddObserver(std::function<void(const Node &)> callback) const
+    {
+      if (!m_observers)
+        m_observers = std::make_shared<detail::ObserverList>();
+      std::lock_guard<std::mutex> lock(m_observers->mutex);
+      unsigned id = m_observers->next_id++;
+      m_observers->callbacks.emplace_back(id, std::move(callback));
+      return Subscription(m_observers, id);
+    }
+
+    void Node::NotifyObservers() const
+    {
+      // Call outside of the lock so that callbacks may themselves observe or
+      // unsubscribe
+      std::vector<std::function<void(const Node &)>> callbacks;
+      {
+        std::lock_guard<std::mutex> lock(m_observers->mutex);
+        for (auto &v: m_observers->callbacks)
+          callbacks.push_back(v.second);
+      }
+      for (auto &callback: callbacks)
+        callback(*this);
+    }
+
     void Node::CheckEmptyOrMissing() const
     {
       if (m_missing)
@@ -282,6 +308,7 @@ namespace Util
           parent = it->second.get();
         }
       }
+      Touch();  // lookups of this path now resolve differently
       return *node;
     }
 
@@ -315,6 +342,7 @@ namespace Util
         ptr_t copied_child = std::make_shared<Node>(*child);
         AddChild(*this, copied_child);
       }
+      Changed();
     }
 
     void Node::Swap(Node &rhs)
@@ -325,6 +353,7 @@ namespace Util
       m_children.swap(rhs.m_children);
      const_cast<std::string *>(&m_key)->swap(*const_cast<std::string *>(&rhs.m_key));
       m_value.swap(rhs.m_value);
+      Changed();
     }
 
     Node &Node::operator=(const Node &rhs)
@@ -6,11 +6,98 @@
 #include <memory>
 #include <exception>
 #include <iterator>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 namespace Util
 {
   namespace Config
   {
+    class Node;
+
+    namespace detail
+    {
+      struct ObserverList
+      {
+        std::mutex mutex;
+        unsigned next_id = 0;
+        std::vector<std::pair<unsigned, std::function<void(const Node &)>>> callbacks;
+      };
+    }
+
+    /*
+     * Subscription:
+     *
+     * Returned by Node::Observe(). The callback stays registered for as long as
+     * this object lives. It holds only a weak reference to the node's observer
+     * list, so it is safe to destroy after the node itself is gone.
+     */
+    class Subscription
+    {
+    public:
+      void Reset()
+      {
+        if (auto list = m_list.lock())
+        {
+          std::lock_guard<std::mutex> lock(list->mutex);
+          for (auto it = list->callbacks.begin(); it != list->callbacks.end(); ++it)
+          {
+            if (it->first == m_id)
+            {
+              list->callbacks.erase(it);
+              break;
+            }
+          }
+        }
+        m_list.reset();
+      }
+
+      Subscription &operator=(Subscription &&rhs) noexcept
+      {
+        if (this != &rhs)
+        {
+          Reset();
+          m_list = std::move(rhs.m_list);
+          m_id = rhs.m_id;
+          rhs.m_list.reset();
+        }
+        return *this;
+      }
+
+      Subscription(Subscription &&that) noexcept
+        : m_list(std::move(that.m_list)),
+          m_id(that.m_id)
+      {
+        that.m_list.reset();
+      }
+
+      Subscription(const std::shared_ptr<detail::ObserverList> &list, unsigned id)
+        : m_list(list),
+          m_id(id)
+      {
+      }
+
+      Subscription()
+        : m_id(0)
+      {
+      }
+
+      Subscription(const Subscription &) = delete;
+      Subscription &operator=(const Subscription &) = delete;
+
+      ~Subscription()
+      {
+        Reset();
+      }
+
+    private:
+      std::weak_ptr<detail::ObserverList> m_list;
+      unsigned m_id;
+    };
+
     class Node
     {
     private:
@@ -24,6 +111,23 @@ namespace Util
       std::map<std::string, ptr_t> m_children;
       mutable std::map<std::string, Node> m_missing_nodes;  // missing nodes from failed queries (must also be empty)
       bool m_missing = false;
+      static std::atomic<uint64_t> s_version;  // bumped whenever any node's value or structure changes
+      mutable std::shared_ptr<detail::ObserverList> m_observers;  // not copied: observers belong to this instance
+
+      static void Touch()
+      {
+        s_version.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      void Changed()
+      {
+        Touch();
+        if (m_observers)
+          NotifyObservers();
+      }
+
+      void NotifyObservers() const;
+      Subscription AddObserver(std::function<void(const Node &)> callback) const;
 
       void Destroy()
       {
@@ -95,11 +199,19 @@ namespace Util
       inline void Clear()
       {
         m_value = nullptr;
+        Changed();
       }
 
       inline void SetValue(const std::shared_ptr<GenericValue> &value)
       {
         m_value = value;
+        Changed();
+      }
+
+      // Global change counter for all config trees, used by Handle<T>
+      static inline uint64_t Version()
+      {
+        return s_version.load(std::memory_order_relaxed);
       }
 
       template <typename T>
@@ -134,6 +246,7 @@ namespace Util
             m_value->Set(value);
           else
             m_value = std::make_shared<ValueInstance<T>>(value);
+          Changed();
         }
         else
           throw std::range_error(Util::Format() << "Node \"" << m_key << "\" does not exist");
@@ -208,6 +321,26 @@ namespace Util
         }
       }
 
+      // Calls the callback with the current value, converted to T, and again
+      // after every change to this node's value for as long as the returned
+      // Subscription lives. Callbacks run on the thread that made the change,
+      // so anything read on another thread should be stored in an atomic
+      // (Observed<T> does this).
+      // Observers belong to this node instance: they are not copied with the
+      // node and are dropped if the node is replaced (e.g., by assigning a
+      // new tree to its parent). An empty value is not reported.
+      template <typename T>
+      Subscription Observe(std::function<void(const T &)> callback) const
+      {
+        if (Exists())
+          callback(ValueAs<T>());
+        return AddObserver([callback](const Node &node)
+        {
+          if (node.Exists())
+            callback(node.ValueAs<T>());
+        });
+      }
+
       // True if value is empty (does not exist)
       inline bool Empty() const
       {
@@ -256,6 +389,94 @@ namespace Util
       ~Node();
     };
 
+    /*
+     * Handle<T>:
+     *
+     * A value looked up by path once and cached as T. Any change to any config
+     * node bumps Node::Version(); the next Get() then resolves the path and
+     * converts the value again. Meant for settings read every frame, where
+     * operator[] and ValueAs<T>() would split the path and parse a string each
+     * time. Missing or empty values throw from Get(), as ValueAs<T>() does.
+     * The root node must outlive the handle.
+     */
+    template <typename T>
+    class Handle
+    {
+    public:
+      T Get() const
+      {
+        uint64_t version = Node::Version();
+        if (version != m_version)
+        {
+          m_value = (*m_root)[m_path].template ValueAs<T>();
+          m_version = version;
+        }
+        return m_value;
+      }
+
+      Handle(const Node &root, const std::string &path)
+        : m_root(&root),
+          m_path(path)
+      {
+      }
+
+      // Unbound handle; must be assigned before Get() is called
+      Handle()
+        : m_root(nullptr)
+      {
+      }
+
+    private:
+      const Node *m_root;
+      std::string m_path;
+      mutable T m_value = T();
+      mutable uint64_t m_version = 0;  // Node::Version() starts at 1, so the first Get() resolves
+    };
+
+    /*
+     * Observed<T>:
+     *
+     * A node's value as T, pushed in by Node::Observe() whenever it changes.
+     * Unlike Handle<T>, Get() may be called from any thread, since the value
+     * is stored atomically by whichever thread changes the config. Meant for
+     * settings read on the emulation threads and changed from the UI. T must
+     * be trivially copyable (bool, integers, float). The initial value is
+     * kept until a node is observed, or if the node is empty.
+     */
+    template <typename T>
+    class Observed
+    {
+    public:
+      T Get() const
+      {
+        return m_value.load(std::memory_order_relaxed);
+      }
+
+      // Follows the given node from now on, instead of any previous one
+      void Observe(const Node &node)
+      {
+        m_subscription = node.Observe<T>([this](const T &value) { m_value.store(value, std::memory_order_relaxed); });
+      }
+
+      Observed(const Node &node, T initial = T())
+        : m_value(initial)
+      {
+        Observe(node);
+      }
+
+      explicit Observed(T initial = T())
+        : m_value(initial)
+      {
+      }
+
+      Observed(const Observed &) = delete;
+      Observed &operator=(const Observed &) = delete;
+
+    private:
+      std::atomic<T> m_value;
+      Subscription m_subscription;  // declared last, so it is released first
+    };
+
     void PrintConfigTree(const Node &config, int indent_level = 0, int tab_stops = 2);
   } // Config
 } // Util
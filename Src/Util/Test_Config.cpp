@@ -202,6 +202,47 @@ int main()
     test_results.push_back({ "Duplicate leaf nodes", config.ToString() == expected_config });
   }
 
+  // Handles cache the converted value and pick up later changes
+  {
+    Util::Config::Node config("global");
+    config.Add<std::string>("Core/Volume", "50");
+    Util::Config::Handle<int> volume(config, "Core/Volume");
+    bool initial = volume.Get() == 50;
+    config["Core/Volume"].SetValue(75);
+    bool after_set = volume.Get() == 75;
+    config.Get("Core").Set<std::string>("Volume", "0x10");
+    bool after_string_set = volume.Get() == 16;
+    config = Util::Config::Node("global");
+    config.Add<std::string>("Core/Volume", "3");
+    bool after_replace = volume.Get() == 3;
+    test_results.push_back({ "Handle", initial && after_set && after_string_set && after_replace });
+  }
+
+  // Observers get the current value, every change, and nothing once released
+  {
+    Util::Config::Node config("global");
+    config.Add<std::string>("Balance", "10");
+    std::vector<float> seen;
+    {
+      auto subscription = config["Balance"].Observe<float>([&seen](const float &v) { seen.push_back(v); });
+      config["Balance"].SetValue(-25.5f);
+      config.Set<std::string>("Balance", "40");
+    }
+    config["Balance"].SetValue(0.0f);
+    test_results.push_back({ "Observer", seen == std::vector<float>{ 10.0f, -25.5f, 40.0f } });
+  }
+
+  // Observed values start out as the node's value and follow it
+  {
+    Util::Config::Node config("global");
+    config.Add<std::string>("Crosshairs", "1");
+    Util::Config::Observed<unsigned> crosshairs(config.Get("Crosshairs"));
+    bool initial = crosshairs.Get() == 1;
+    config.Get("Crosshairs").SetValue(3u);
+    bool after_set = crosshairs.Get() == 3;
+    test_results.push_back({ "Observed", initial && after_set });
+  }
+
   PrintTestResults(test_results);
   return 0;
 }